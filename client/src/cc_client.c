@@ -138,14 +138,25 @@ static void *reader(void *arg)
                         "raw_data", &encode);
 
                     // decode data
-                    base64_decode(encode, strlen(encode), raw_data);
-
-                    // update list callback
-                    cc_update_list_t *updates = cc_update_parse(device_id, raw_data, true);
-                    if (client->data_update_cb)
-                        client->data_update_cb(updates);
-
-                     cc_update_free(updates);
+                    int raw_size = -1;
+                    if (encode && base64_decode(encode, strlen(encode), raw_data) == BASE64_OK)
+                    {
+                        // decoded size, minus the padding
+                        const int size = strlen(encode);
+                        raw_size = BASE64_DECODE_OUT_SIZE(size);
+                        for (int i = size - 1; i >= 0 && encode[i] == '='; i--)
+                            raw_size--;
+                    }
+
+                    // update list callback, malformed updates are dropped
+                    cc_update_list_t *updates = cc_update_parse(device_id, raw_data, raw_size, true);
+                    if (updates)
+                    {
+                        if (client->data_update_cb)
+                            client->data_update_cb(updates);
+
+                        cc_update_free(updates);
+                    }
                 }
 
                 json_decref(root);
@@ -65,21 +65,16 @@
 ****************************************************************************************************
 */
 
-
-/*
-****************************************************************************************************
-*       GLOBAL FUNCTIONS
-****************************************************************************************************
-*/
-
-int cc_assignment_add(const cc_assignment_t *assignment)
+static int assignment_add(const cc_assignment_t *assignment)
 {
     cc_device_t *device = cc_device_get(assignment->device_id);
 
     if (!device)
         return -1;
 
-    if (assignment->actuator_id >= device->actuators_count * device->amount_of_pages)
+    int page;
+    cc_actuator_t *actuator = cc_device_actuator(device, assignment->actuator_id, &page);
+    if (!actuator)
         return -1;
 
     // if is the first time, create list of assignments
@@ -87,8 +82,7 @@ int cc_assignment_add(const cc_assignment_t *assignment)
         device->assignments = calloc(CC_MAX_ASSIGNMENTS, sizeof(cc_assignment_t *));
 
     // check the amount of assignments supported by the actuator
-    cc_actuator_t *actuator = device->actuators[assignment->actuator_id];
-    if (actuator->assignments_count >= actuator->max_assignments)
+    if (actuator->assignments_count[page] >= actuator->max_assignments)
         return -1;
 
     // store assignment
@@ -103,8 +97,7 @@ int cc_assignment_add(const cc_assignment_t *assignment)
             device->assignments[i]->id = i;
 
             // increment actuator assignments counter
-            cc_actuator_t *actuator = device->actuators[assignment->actuator_id];
-            actuator->assignments_count++;
+            actuator->assignments_count[page]++;
 
             return i;
         }
@@ -113,7 +106,7 @@ int cc_assignment_add(const cc_assignment_t *assignment)
     return -1;
 }
 
-int cc_assignment_remove(const cc_assignment_key_t *assignment)
+static int assignment_remove(const cc_assignment_key_t *assignment)
 {
     cc_device_t *device = cc_device_get(assignment->device_id);
 
@@ -134,8 +127,10 @@ int cc_assignment_remove(const cc_assignment_key_t *assignment)
         device->assignments[i] = NULL;
 
         // decrement actuator assignments counter
-        cc_actuator_t *actuator = device->actuators[actuator_id];
-        actuator->assignments_count--;
+        int page;
+        cc_actuator_t *actuator = cc_device_actuator(device, actuator_id, &page);
+        if (actuator)
+            actuator->assignments_count[page]--;
 
         return assignment->id;
     }
@@ -143,6 +138,32 @@ int cc_assignment_remove(const cc_assignment_key_t *assignment)
     return -1;
 }
 
+
+/*
+****************************************************************************************************
+*       GLOBAL FUNCTIONS
+****************************************************************************************************
+*/
+
+int cc_assignment_add(const cc_assignment_t *assignment)
+{
+    // the actuators are part of the device descriptor
+    cc_device_lock();
+    int ret = assignment_add(assignment);
+    cc_device_unlock();
+
+    return ret;
+}
+
+int cc_assignment_remove(const cc_assignment_key_t *assignment)
+{
+    cc_device_lock();
+    int ret = assignment_remove(assignment);
+    cc_device_unlock();
+
+    return ret;
+}
+
 int cc_assignment_check(const cc_assignment_key_t *assignment)
 {
     cc_device_t *device = cc_device_get(assignment->device_id);
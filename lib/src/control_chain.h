@@ -33,6 +33,9 @@
 #include "device.h"
 #include "assignment.h"
 #include "update.h"
+#include "stats.h"
+#include "transport.h"
+#include "dispatcher.h"
 
 
 /*
@@ -45,8 +48,6 @@
 #define CC_PROTOCOL_MINOR       7
 #define CC_PROTOCOL_VERSION     STR(CC_PROTOCOL_MAJOR) "." STR(CC_PROTOCOL_MINOR)
 
-#define MAX_ACTUATOR_PAGES      16
-
 /*
 ****************************************************************************************************
 *       CONFIGURATION
@@ -75,6 +76,21 @@ void cc_data_update_cb(cc_handle_t *handle, void (*callback)(void *arg));
 void cc_device_status_cb(cc_handle_t *handle, void (*callback)(void *arg));
 void cc_device_disable(cc_handle_t *handle, int device_id);
 
+// asynchronous variants, they queue the request and return without waiting for the requests cycle
+// the completion is optional, when given it's completed exactly once, also when nothing is sent
+int cc_assignment_async(cc_handle_t *handle, cc_assignment_t *assignment, bool new_assignment,
+    cc_completion_t *completion);
+void cc_unassignment_async(cc_handle_t *handle, cc_assignment_key_t *assignment,
+    cc_completion_t *completion);
+int cc_value_set_async(cc_handle_t *handle, cc_set_value_t *update, cc_completion_t *completion);
+void cc_device_disable_async(cc_handle_t *handle, int device_id, cc_completion_t *completion);
+
+void cc_sync_stats(cc_handle_t *handle, cc_sync_stats_t *stats, bool reset);
+void cc_tx_stats(cc_handle_t *handle, cc_tx_stats_t *stats);
+void cc_link_stats(cc_handle_t *handle, cc_link_stats_t *stats);
+void cc_dispatch_stats(cc_handle_t *handle, cc_dispatch_stats_t *stats);
+void cc_bus_stats(cc_handle_t *handle, cc_bus_stats_t *stats);
+
 
 /*
 ****************************************************************************************************
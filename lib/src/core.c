@@ -23,17 +23,26 @@
 ****************************************************************************************************
 */
 
-#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
 #include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
 #include <semaphore.h>
-#include <libserialport.h>
+#include <linux/serial.h>
 
 #include "control_chain.h"
 #include "core.h"
@@ -43,6 +52,8 @@
 #include "device.h"
 #include "assignment.h"
 #include "update.h"
+#include "stats.h"
+#include "dispatcher.h"
 
 
 /*
@@ -56,12 +67,43 @@
 #define CC_HEADER_TIMEOUT       10      // in ms
 #define CC_DATA_TIMEOUT         1000    // in ms
 
+#define CC_RX_BUFFER_SIZE       1024    // in bytes
+
+// sync byte, header, sync cycle and crc
+#define CC_SYNC_FRAME_SIZE      (CC_MSG_HEADER_SIZE + 3)
+
+#define CC_TX_FRAMES_MAX        16      // frames coalesced in a single write
+#define CC_TX_BACKLOG_SIZE      (2 * CC_DATA_BUFFER_SIZE)
+#define CC_TX_ARENA_SIZE        (CC_DATA_BUFFER_SIZE + 2)   // frames built in place, fits the longest one
+
 #define CC_CHAIN_SYNC_INTERVAL  10000   // in us
 #define CC_RESPONSE_TIMEOUT     100     // in ms
+#define CC_INFLIGHT_MAX         CC_MAX_DEVICES  // requests waiting for a reply at the same time
+#define CC_DESCRIPTORS_INFLIGHT 4       // descriptor requests outstanding at the same time
 
 #define CC_REQUESTS_PERIOD      2       // in sync cycles
+#define CC_REQUESTS_AIRTIME     8000    // in us, transmission time budget of a requests window
+#define CC_REQUESTS_MAX         (CC_TX_FRAMES_MAX - 1)  // requests per window, the sync frame goes along
 #define CC_HANDSHAKE_PERIOD     20      // in sync cycles
 #define CC_DEVICE_TIMEOUT       100     // in sync cycles
+#define CC_IDLE_INTERVAL_MAX    1000000 // in us, longest sync interval while no device is on the chain
+#define CC_SYNC_INTERVAL_MIN    2000    // in us, shortest auto sized sync interval
+#define CC_TIMING_WINDOW        100     // in sync cycles, how often the auto timing shrinks the interval
+#define CC_UPDATE_FRAME_SIZE    16      // in bytes, data update allowance per device and cycle
+#define CC_REPLY_SIZE           512     // in bytes, reply allowance (e.g.: device descriptor)
+
+#define CC_EVENTS_MAX           4       // epoll events per wakeup
+
+#define CC_PORT_PATH_SIZE       64
+#define CC_SERIAL_WAIT_TIMEOUT  100     // in ms, how often serial_wait() checks if it must stop
+#define CC_SERIAL_ACCESS_TIMEOUT 1000   // in ms, to get permission to access a new serial port
+#define CC_PROBE_TIMEOUT        3000    // in ms, to receive the first frame after reset
+
+#define CC_LATENCY_TIMER        1       // in ms, usb-serial latency timer used in low latency mode
+
+#define CC_LINK_VERIFY_CYCLES   50      // cycles to validate the link after a baud rate change
+#define CC_LINK_ERRORS_MAX      4       // bad frames tolerated per verify window
+#define CC_LINK_RESCAN_PERIOD   1000    // cycles at the upgraded rate before listening for new devices
 
 // debug macro
 #define DEBUG_MSG(...)      do { if (g_debug) fprintf(stderr, "[cc-lib] " __VA_ARGS__); } while (0)
@@ -73,6 +115,13 @@
 ****************************************************************************************************
 */
 
+// maximum time to wait for the next bytes according the receiver state (in ms)
+static const unsigned int g_rx_timeouts[] = {
+    CC_SYNC_TIMEOUT, CC_HEADER_TIMEOUT, CC_DATA_TIMEOUT, CC_DATA_TIMEOUT
+};
+
+// device descriptor request data, queued frames reference it until written
+static const uint8_t g_descriptor_request = CC_DEVICE_DESC_REQ;
 
 /*
 ****************************************************************************************************
@@ -84,23 +133,94 @@
 enum {WAITING_SYNCING, WAITING_HEADER, WAITING_DATA, WAITING_CRC};
 
 // sync message cycles definition
-enum {CC_SYNC_SETUP_CYCLE, CC_SYNC_REGULAR_CYCLE, CC_SYNC_HANDSHAKE_CYCLE};
+enum {CC_SYNC_SETUP_CYCLE, CC_SYNC_REGULAR_CYCLE, CC_SYNC_HANDSHAKE_CYCLE, CC_SYNC_CYCLES};
+
+// event loop sources
+enum {CC_EVENT_SERIAL, CC_EVENT_TIMER, CC_EVENT_REQUEST, CC_EVENT_PORT};
+
+// link negotiation states
+enum {CC_LINK_DEFAULT, CC_LINK_VERIFYING, CC_LINK_UPGRADED, CC_LINK_FAILED};
+
+// requests priorities, value changes are user feedback and go ahead of (un)assignments
+enum {CC_PRIORITY_HIGH, CC_PRIORITY_NORMAL, CC_PRIORITIES};
+
+// request waiting for a requests cycle
+// detached requests own their message and nobody waits for them, the completion (if any) is
+// completed instead
+typedef struct cc_request_t {
+    cc_msg_t *msg;
+    int ret, detached;
+    sem_t done;
+    cc_completion_t *completion;
+    struct cc_request_t *next;
+} cc_request_t;
+
+// request waiting for a reply, replies are matched by device id and command
+// device id 0 (broadcast) marks a free entry, broadcasts are never replied
+typedef struct cc_inflight_t {
+    int device_id, command, waited;
+    int64_t sent, deadline;
+    sem_t reply;
+} cc_inflight_t;
 
 // control chain handle struct
 struct cc_handle_t {
-    int state;
+    int state, engine, low_latency;
     const char *port_name;
     int baudrate, serial_enabled;
-    struct sp_port *sp;
+    const char *transport_address;
+    cc_transport_t transport;
     void (*data_update_cb)(void *arg);
     void (*device_status_cb)(void *arg);
-    pthread_t receiver_thread, chain_sync_thread;
+    cc_dispatcher_t *dispatcher;
+    pthread_t receiver_thread, chain_sync_thread, event_loop_thread;
     pthread_mutex_t running, sending;
-    sem_t waiting_response;
+    pthread_mutex_t inflight_lock;
+    cc_inflight_t inflight[CC_INFLIGHT_MAX];
     pthread_mutex_t request_lock;
-    pthread_cond_t request_cond;
-    atomic_bool request_sync;
+    cc_request_t *requests[CC_PRIORITIES], *requests_tail[CC_PRIORITIES];
+    unsigned int cycles_counter;
+    int epoll_fd, timer_fd, event_fd, serial_fd, inotify_fd;
+    int64_t access_deadline;
+    int descriptor_device_id, descriptors_inflight;
+    int64_t probe_deadline, rx_frame_timestamp;
+    // written by the receiving context, only accessed atomically so it never tears
+    int64_t rx_timestamp;
+    int latency_timer_default;
+    int link_state, link_baudrate, link_framing, line_baudrate;
+    int framing, rx_framing;
+    unsigned int link_cycle, link_window, link_errors, link_frames;
+    char latency_timer_path[CC_PORT_PATH_SIZE + 64];
+    cc_link_stats_t link_stats;
+    int64_t sync_deadline, sync_timestamp, sync_interval;
+    int idle, idle_wakeup, idle_requests, auto_timing;
+    int64_t response_timeout, airtime_peak;
+    uint32_t cycle_tx_bytes, cycle_rx_bytes;
+    cc_bus_stats_t bus_stats;
+    int64_t mode_timestamp;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    pthread_mutex_t stats_lock;
+    cc_sync_stats_t sync_stats;
+    uint8_t sync_frames[CC_SYNC_CYCLES][CC_SYNC_FRAME_SIZE];
+    uint8_t sync_frames_cobs[CC_SYNC_CYCLES][COBS_ENCODED_SIZE(CC_SYNC_FRAME_SIZE)];
+    int sync_frames_cobs_size[CC_SYNC_CYCLES];
+    unsigned int requests_count;
+    struct iovec tx_iov[CC_TX_FRAMES_MAX * 3];
+    uint8_t tx_headers[CC_TX_FRAMES_MAX][CC_MSG_HEADER_SIZE + 1];
+    uint8_t tx_crcs[CC_TX_FRAMES_MAX];
+    int tx_iovcnt, tx_frames, tx_pending, tx_backlog_size, tx_watching;
+    unsigned int tx_writes;
+    uint8_t tx_backlog[CC_TX_BACKLOG_SIZE];
+    uint8_t tx_cobs[CC_TX_BACKLOG_SIZE];
+    int tx_cobs_size;
+    uint8_t tx_arena[CC_TX_ARENA_SIZE];
+    int tx_arena_size;
+    cc_tx_stats_t tx_stats;
     cc_msg_t *msg_rx;
+    uint8_t rx_buffer[CC_RX_BUFFER_SIZE];
+    int rx_count;
+    uint8_t rx_crc, rx_cobs_code, rx_cobs_left;
 };
 
 
@@ -119,300 +239,2086 @@ static int g_debug;
 ****************************************************************************************************
 */
 
-static int serial_setup(cc_handle_t *handle)
+static int64_t clock_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int running(cc_handle_t *handle)
+{
+    switch (pthread_mutex_trylock(&handle->running))
+    {
+        case 0:
+            pthread_mutex_unlock(&handle->running);
+            return 0;
+
+        case EBUSY:
+            return 1;
+    }
+
+    return 0;
+}
+
+static struct timespec us_to_timespec(int64_t value)
+{
+    struct timespec ts = {
+        .tv_sec = value / 1000000,
+        .tv_nsec = (value % 1000000) * 1000,
+    };
+
+    return ts;
+}
+
+// account a new sync cycle started right now
+// returns the amount of cycles missed since the previous one
+static int sync_clock_update(cc_handle_t *handle)
+{
+    int64_t now = clock_us();
+    int64_t lateness = now - handle->sync_deadline;
+    int missed = lateness / handle->sync_interval;
+
+    pthread_mutex_lock(&handle->stats_lock);
+    if (handle->sync_timestamp)
+        cc_histogram_add(&handle->sync_stats.period, now - handle->sync_timestamp);
+    cc_histogram_add(&handle->sync_stats.lateness, lateness);
+    handle->sync_stats.cycles++;
+    handle->sync_stats.overruns += missed;
+    pthread_mutex_unlock(&handle->stats_lock);
+
+    // missed cycles are skipped, the next deadline stays in phase with the previous ones
+    handle->sync_deadline += (missed + 1) * handle->sync_interval;
+    handle->sync_timestamp = now;
+
+    return missed;
+}
+
+// write the latency timer of usb-serial adapters which expose it on sysfs (e.g.: FTDI)
+// returns the previous value or -1 if not available
+static int serial_latency_timer(cc_handle_t *handle, int value)
+{
+    FILE *file = fopen(handle->latency_timer_path, "r+");
+    if (!file)
+        return -1;
+
+    int current;
+    if (fscanf(file, "%d", &current) != 1)
+        current = -1;
+
+    if (current >= 0 && current != value)
+    {
+        rewind(file);
+        fprintf(file, "%d", value);
+    }
+
+    fclose(file);
+
+    return current;
+}
+
+static void serial_low_latency(cc_handle_t *handle, const char *port_path)
+{
+    int fd = handle->serial_fd;
+
+    // ask the driver to push received bytes to the tty layer right away
+    struct serial_struct serial;
+    handle->link_stats.low_latency = 0;
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serial) == 0)
+            handle->link_stats.low_latency = 1;
+    }
+
+    // reads return whatever is available, no minimum size nor inter-byte timer
+    struct termios tty;
+    if (tcgetattr(fd, &tty) == 0)
+    {
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+
+    // usb-serial adapters hold the received bytes until their latency timer expires
+    // the default value (usually 16 ms) is longer than a whole sync cycle
+    // the device name is at most a port path long, so the sysfs path always fits
+    const char *name = strrchr(port_path, '/');
+    int size = snprintf(handle->latency_timer_path, sizeof(handle->latency_timer_path),
+        "/sys/bus/usb-serial/devices/%.*s/latency_timer", CC_PORT_PATH_SIZE, name ? name + 1 : port_path);
+
+    // an empty path is never opened, the latency timer is left as is
+    if (size < 0 || size >= (int) sizeof(handle->latency_timer_path))
+        handle->latency_timer_path[0] = 0;
+
+    handle->latency_timer_default = serial_latency_timer(handle, CC_LATENCY_TIMER);
+    handle->link_stats.latency_timer = handle->latency_timer_default;
+
+    if (handle->latency_timer_default >= 0)
+    {
+        // read it back, the driver might not accept the value
+        handle->link_stats.latency_timer = serial_latency_timer(handle, CC_LATENCY_TIMER);
+
+        DEBUG_MSG("latency timer changed from %i ms to %i ms\n",
+            handle->latency_timer_default, handle->link_stats.latency_timer);
+    }
+}
+
+static void serial_close(cc_handle_t *handle)
+{
+    pthread_mutex_lock(&handle->sending);
+
+    handle->serial_enabled = 0;
+    handle->tx_backlog_size = 0;
+
+    // restore the latency timer
+    if (handle->latency_timer_default >= 0 && handle->latency_timer_path[0])
+    {
+        serial_latency_timer(handle, handle->latency_timer_default);
+        handle->latency_timer_path[0] = 0;
+    }
+
+    if (handle->transport.fd >= 0)
+        handle->transport.ops->close(&handle->transport);
+
+    pthread_mutex_unlock(&handle->sending);
+}
+
+// check if the serial port is ready to be opened
+// returns 0 if ready, 1 if it must be waited, -1 on error
+static int serial_check(cc_handle_t *handle, char *port_path, int64_t *access_deadline)
 {
-    // wait until path show up
     struct stat stbuf;
-    while (1)
+    if (lstat(handle->port_name, &stbuf))
     {
-        if (lstat(handle->port_name, &stbuf))
-        {
-            // check for "no such file or directory" error
-            if (errno == ENOENT)
-                sleep(1);
-            else
-                return -1;
-        }
-        else
-            break;
+        // check for "no such file or directory" error
+        return errno == ENOENT ? 1 : -1;
     }
 
     // set default port path
-    char port_path[64];
     strcpy(port_path, handle->port_name);
 
     // check for symbolic link
     if (S_ISLNK(stbuf.st_mode))
     {
-        // try to access file
-        for (int i = 0; i < 10; i++)
+        // read link and add its content after "/dev/"
+        int len = readlink(handle->port_name, &port_path[5], CC_PORT_PATH_SIZE-5-1);
+        if (len < 0)
+            return 1;
+
+        port_path[len+5] = 0;
+
+        // check for "permission denied" error
+        // after the usb-serial is plugged in, the system might take
+        // some time until it set the correct permissions to the file
+        if (access(port_path, R_OK | W_OK))
         {
-            // read link and add its content after "/dev/"
-            int len = readlink(handle->port_name, &port_path[5], sizeof(port_path)-5);
-            port_path[len+5] = 0;
-
-            // check for "permission denied" error
-            // after the usb-serial is plugged in, the system might take
-            // some time until it set the correct permissions to the file
-            if (access(port_path, R_OK | W_OK))
-            {
-                if (errno == EACCES)
-                    usleep(100000);
-                else
-                    return -1;
-            }
-            else
-            {
-                // user has access to the file
-                break;
-            }
+            if (errno != EACCES && errno != ENOENT)
+                return -1;
+
+            if (*access_deadline == 0)
+                *access_deadline = clock_us() + CC_SERIAL_ACCESS_TIMEOUT * 1000;
+
+            // give up waiting, let the open fail
+            if (clock_us() < *access_deadline)
+                return 1;
         }
     }
 
-    enum sp_return ret;
+    return 0;
+}
 
-    // get serial port
-    ret = sp_get_port_by_name(port_path, &handle->sp);
-    if (ret != SP_OK)
-        return ret;
+// inotify reports when the port is created or its permissions change
+// returns the inotify file descriptor or -1 if not available
+static int serial_watch(cc_handle_t *handle)
+{
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+        return -1;
 
-    // open serial port
-    ret = sp_open(handle->sp, SP_MODE_READ_WRITE);
-    if (ret != SP_OK)
+    const uint32_t mask = IN_CREATE | IN_ATTRIB | IN_MOVED_TO;
+
+    // directory of the port name and the one where the links point to
+    char dir[CC_PORT_PATH_SIZE];
+    strncpy(dir, handle->port_name, sizeof(dir)-1);
+    dir[sizeof(dir)-1] = 0;
+
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir)
+    {
+        *slash = 0;
+        inotify_add_watch(inotify_fd, dir, mask);
+    }
+
+    inotify_add_watch(inotify_fd, "/dev", mask);
+
+    return inotify_fd;
+}
+
+// wait until the serial port shows up and is accessible
+static int serial_wait(cc_handle_t *handle, char *port_path)
+{
+    int64_t access_deadline = 0;
+
+    int ret = serial_check(handle, port_path, &access_deadline);
+    if (ret <= 0)
         return ret;
 
-    // disable XON/XOFF flow control
-    sp_set_xon_xoff(handle->sp, SP_XONXOFF_DISABLED);
+    int inotify_fd = serial_watch(handle);
+
+    DEBUG_MSG("waiting for serial port %s\n", handle->port_name);
+
+    while ((ret = serial_check(handle, port_path, &access_deadline)) > 0)
+    {
+        if (!running(handle))
+        {
+            ret = -1;
+            break;
+        }
+
+        if (inotify_fd < 0)
+        {
+            usleep(CC_SERIAL_WAIT_TIMEOUT * 1000);
+            continue;
+        }
+
+        // the events content doesn't matter, the port is checked again anyway
+        struct pollfd pfd = {.fd = inotify_fd, .events = POLLIN};
+        if (poll(&pfd, 1, CC_SERIAL_WAIT_TIMEOUT) > 0)
+        {
+            uint8_t events[1024];
+            while (read(inotify_fd, events, sizeof(events)) > 0);
+        }
+    }
+
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+
+    return ret;
+}
+
+// open the port once it's there and accessible
+static int serial_open(cc_handle_t *handle, const char *address)
+{
+    if (handle->transport.ops->open(&handle->transport, address, handle->baudrate))
+        return -1;
+
+    // file descriptor is used for vectored writes and by the event loop
+    handle->serial_fd = handle->transport.ops->fd(&handle->transport);
 
-    // configure serial port
-    sp_set_baudrate(handle->sp, handle->baudrate);
+    if (handle->low_latency)
+        serial_low_latency(handle, address);
 
-    // sleeps some seconds if it's an Arduino connected (initialization)
-    char *manufacturer = sp_get_port_usb_manufacturer(handle->sp);
-    if (manufacturer && strstr(manufacturer, "Arduino"))
-        sleep(3);
+    // Arduino resets when the port is opened, instead of waiting some seconds for
+    // its initialization, the chain is probed until the first valid frame arrives
+    if (handle->transport.reset_on_open)
+        handle->probe_deadline = clock_us() + CC_PROBE_TIMEOUT * 1000;
 
+    // the link always starts at the default baud rate and raw framing
+    handle->link_state = CC_LINK_DEFAULT;
+    handle->link_cycle = handle->cycles_counter;
+    handle->framing = handle->rx_framing = CC_FRAMING_RAW;
+    handle->line_baudrate = handle->baudrate;
+    pthread_mutex_lock(&handle->stats_lock);
+    handle->link_stats.baudrate = handle->baudrate;
+    handle->link_stats.framing = CC_FRAMING_RAW;
+    pthread_mutex_unlock(&handle->stats_lock);
+
+    handle->state = WAITING_SYNCING;
     handle->serial_enabled = 1;
 
+    DEBUG_MSG("%s port %s ready\n", handle->transport.ops->name, address);
+
     return 0;
 }
 
-static void send(cc_handle_t *handle, const cc_msg_t *msg)
+static int serial_setup(cc_handle_t *handle)
 {
-    if (handle && msg && handle->serial_enabled)
+    char port_path[CC_PORT_PATH_SIZE];
+    const char *address = handle->transport_address;
+
+    // usb-serial ports come and go
+    if (handle->transport.ops == &cc_transport_serial)
     {
-        uint8_t buffer[CC_DATA_BUFFER_SIZE];
+        if (serial_wait(handle, port_path))
+            return -1;
 
-        // sync byte
-        buffer[0] = CC_SYNC_BYTE;
+        address = port_path;
+    }
 
-        // header
-        int i = 1;
-        buffer[i++] = msg->device_id;
-        buffer[i++] = msg->command;
-        buffer[i++] = (msg->data_size >> 0) & 0xFF;
-        buffer[i++] = (msg->data_size >> 8) & 0xFF;
+    return serial_open(handle, address);
+}
 
-        // data
-        if (msg->data_size > 0)
-        {
-            memcpy(&buffer[i], msg->data, msg->data_size);
-            i += msg->data_size;
-        }
+// while probing only handshake cycles are sent so a booting device isn't flooded
+static int probing(cc_handle_t *handle)
+{
+    if (handle->probe_deadline && clock_us() >= handle->probe_deadline)
+    {
+        DEBUG_MSG("probe timeout, no valid frame received\n");
+        handle->probe_deadline = 0;
+    }
 
-        // calculate crc (skip sync byte)
-        buffer[i++] = crc8(&buffer[1], CC_MSG_HEADER_SIZE + msg->data_size);
+    return handle->probe_deadline != 0;
+}
 
-        pthread_mutex_lock(&handle->sending);
-        int ret = sp_nonblocking_write(handle->sp, buffer, i);
+// program the event loop timer with the current sync deadline and interval
+static int sync_timer_set(cc_handle_t *handle)
+{
+    struct itimerspec interval = {
+        .it_interval = us_to_timespec(handle->sync_interval),
+        .it_value = us_to_timespec(handle->sync_deadline),
+    };
 
-        // check for input/output error
-        // this error may happen when the serial file descriptor isn't
-        // valid anymore (e.g.: usb-serial device was been removed)
-        if (ret == SP_ERR_FAIL && errno == EIO)
-        {
-            handle->serial_enabled = 0;
-            sp_close(handle->sp);
-            sp_free_port(handle->sp);
-        }
+    return timerfd_settime(handle->timer_fd, TFD_TIMER_ABSTIME, &interval, NULL);
+}
 
-        pthread_mutex_unlock(&handle->sending);
+// change the sync interval, the next cycle starts one interval from now
+// must only be called from the thread running the sync cycles
+static void sync_interval_set(cc_handle_t *handle, int64_t interval)
+{
+    handle->sync_interval = interval;
+    handle->sync_deadline = clock_us() + interval;
 
-        // print message if debug is enabled
-        cc_msg_print("SEND", msg);
-    }
+    if (handle->engine == CC_ENGINE_EVENT_LOOP)
+        sync_timer_set(handle);
 }
 
-static int send_and_wait(cc_handle_t *handle, const cc_msg_t *msg)
+// switch between the regular cadence and the idle mode, accounting the time spent in each one
+static void sync_mode(cc_handle_t *handle, int idle)
 {
-    send(handle, msg);
+    pthread_mutex_lock(&handle->idle_lock);
+    handle->idle_wakeup = 0;
+    handle->idle_requests = 0;
+    pthread_mutex_unlock(&handle->idle_lock);
+
+    if (handle->idle == idle)
+        return;
+
+    int64_t now = clock_us();
+
+    pthread_mutex_lock(&handle->stats_lock);
+    if (handle->idle)
+        handle->sync_stats.idle_time += now - handle->mode_timestamp;
+    else
+        handle->sync_stats.active_time += now - handle->mode_timestamp;
+    handle->mode_timestamp = now;
+    handle->idle = idle;
+    pthread_mutex_unlock(&handle->stats_lock);
 
-    // set timeout
-    struct timespec timeout;
-    clock_gettime(CLOCK_REALTIME, &timeout);
-    timeout.tv_sec += ((CC_RESPONSE_TIMEOUT * 1000000) / 1000000000);
-    timeout.tv_nsec += ((CC_RESPONSE_TIMEOUT * 1000000) % 1000000000);
+    DEBUG_MSG("chain sync %s\n", idle ? "idle" : "active");
 
-    if (timeout.tv_nsec >= 1000000000)
+    // idle mode starts at the handshake cadence, so devices are found as fast as usual
+    sync_interval_set(handle, idle ? CC_HANDSHAKE_PERIOD * CC_CHAIN_SYNC_INTERVAL : CC_CHAIN_SYNC_INTERVAL);
+}
+
+// a device showed up, leave the idle mode
+static void sync_wakeup(cc_handle_t *handle)
+{
+    // the event loop runs the sync cycles itself
+    if (handle->engine == CC_ENGINE_EVENT_LOOP)
     {
-        timeout.tv_sec += 1;
-        timeout.tv_nsec -= 1000000000;
+        sync_mode(handle, 0);
+        return;
     }
 
-    // only one request must be done per time
-    // because all devices share the same serial line
-    for (;;)
-    {
-        // TESTING DEBUG
-        static const char *commands[] = {
-            "sync", "handshake", "device control", "device descriptor",
-            "assignment", "data update", "unassignment", "set value", "update list items", "request control page"
-        };
+    pthread_mutex_lock(&handle->idle_lock);
+    handle->idle_wakeup = 1;
+    pthread_cond_signal(&handle->idle_cond);
+    pthread_mutex_unlock(&handle->idle_lock);
+}
+
+// a request was queued, an idle chain runs a cycle right away to serve it (threads engine)
+static void sync_requests(cc_handle_t *handle)
+{
+    pthread_mutex_lock(&handle->idle_lock);
+    handle->idle_requests = 1;
+    pthread_cond_signal(&handle->idle_cond);
+    pthread_mutex_unlock(&handle->idle_lock);
+}
+
+// wait for the next sync cycle (threads engine)
+static void sync_wait(cc_handle_t *handle)
+{
+    struct timespec deadline = us_to_timespec(handle->sync_deadline);
 
-        if (sem_timedwait(&handle->waiting_response, &timeout) == 0)
+    if (handle->idle)
+    {
+        // idle waits are long, a handshake, a request or cc_finish() cut them short
+        pthread_mutex_lock(&handle->idle_lock);
+        while (!handle->idle_wakeup && !handle->idle_requests && running(handle))
         {
-            DEBUG_MSG("timedwait ok! %s\n", commands[msg->command]);
-            return 0;
+            if (pthread_cond_timedwait(&handle->idle_cond, &handle->idle_lock, &deadline) == ETIMEDOUT)
+                break;
         }
+        int wakeup = handle->idle_wakeup;
+        int requests = handle->idle_requests;
+        handle->idle_requests = 0;
+        pthread_mutex_unlock(&handle->idle_lock);
 
-        int e = errno;
-        DEBUG_MSG("timedwait error %d for %s\n", e, commands[msg->command]);
+        if (!wakeup)
+        {
+            // the cycle serving the requests starts now, the chain stays idle
+            if (requests)
+                handle->sync_deadline = clock_us();
 
-        if (e != EINTR)
-            return 1;
+            return;
+        }
+
+        // back to the regular cadence, the first cycle is one interval away
+        sync_mode(handle, 0);
+        deadline = us_to_timespec(handle->sync_deadline);
     }
+
+    // deadlines are absolute so the work done during a cycle doesn't make the cadence drift
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
 }
 
-static int request(cc_handle_t *handle, const cc_msg_t *msg)
+static int devices_count(void)
 {
-    // lock and wait for request cycle
-    pthread_mutex_lock(&handle->request_lock);
-    while (!atomic_load(&handle->request_sync))
-        pthread_cond_wait(&handle->request_cond, &handle->request_lock);
+    int count = 0;
 
-    // send message, only wait if a reply is expected
-    int ret;
-    switch (msg->command)
+    for (int id = 1; id <= CC_MAX_DEVICES; id++)
     {
-    case CC_CMD_DEV_DESCRIPTOR:
-        ret = send_and_wait(handle, msg);
-        break;
-    default:
-        send(handle, msg);
-        ret = 0;
-        break;
+        if (cc_device_get(id))
+            count++;
     }
 
-    // unlock for next request
-    atomic_store(&handle->request_sync, false);
-    pthread_mutex_unlock(&handle->request_lock);
-
-    return ret;
+    return count;
 }
 
-static int running(cc_handle_t *handle)
+// while no device is on the chain only handshake cycles are sent, each time further apart
+// returns 1 while idle
+static int sync_idle(cc_handle_t *handle)
 {
-    switch (pthread_mutex_trylock(&handle->running))
+    if (devices_count())
     {
-        case 0:
-            pthread_mutex_unlock(&handle->running);
-            return 0;
+        sync_mode(handle, 0);
+        return 0;
+    }
 
-        case EBUSY:
-            return 1;
+    if (!handle->idle)
+    {
+        sync_mode(handle, 1);
+        return 1;
     }
 
-    return 0;
+    // a device which was just reset is expected to show up soon
+    if (probing(handle))
+        return 1;
+
+    int64_t interval = handle->sync_interval * 2;
+    if (interval > CC_IDLE_INTERVAL_MAX)
+        interval = CC_IDLE_INTERVAL_MAX;
+
+    if (interval != handle->sync_interval)
+        sync_interval_set(handle, interval);
+
+    return 1;
 }
 
-#define UPDATE_DATA_SIZE (sizeof(float) + 1)
+// time the given amount of bytes take on the line, in us
+static int64_t airtime_us(const cc_handle_t *handle, int64_t bytes)
+{
+    // start and stop bits
+    return bytes * 10 * 1000000 / handle->line_baudrate;
+}
 
-static void parse_data_update(cc_handle_t *handle)
+// account the bytes sent and received during the cycle which just ended
+static void airtime_update(cc_handle_t *handle)
 {
-    const cc_msg_t *msg = handle->msg_rx;
+    uint32_t tx = __atomic_exchange_n(&handle->cycle_tx_bytes, 0, __ATOMIC_RELAXED);
+    uint32_t rx = __atomic_exchange_n(&handle->cycle_rx_bytes, 0, __ATOMIC_RELAXED);
+
+    int64_t airtime = airtime_us(handle, tx + rx);
+    uint32_t load = airtime * 1000 / handle->sync_interval;
+
+    if (airtime > handle->airtime_peak)
+        handle->airtime_peak = airtime;
+
+    pthread_mutex_lock(&handle->stats_lock);
+    handle->bus_stats.tx_bytes += tx;
+    handle->bus_stats.rx_bytes += rx;
+    cc_histogram_add(&handle->bus_stats.airtime, airtime);
+    handle->bus_stats.load = load;
+    if (load > handle->bus_stats.load_max)
+        handle->bus_stats.load_max = load;
+    handle->bus_stats.sync_interval = handle->sync_interval;
+    handle->bus_stats.response_timeout = handle->response_timeout;
+    pthread_mutex_unlock(&handle->stats_lock);
+}
 
-    // parse message to update list
-    cc_update_list_t *updates;
-    cc_msg_parser(msg, &updates);
+// size the sync interval from the busiest cycle and the devices count, and the reply timeout from it
+// the interval grows as soon as a cycle gets 3/4 full and only shrinks once per timing window
+static void timing_update(cc_handle_t *handle)
+{
+    if (!handle->auto_timing)
+        return;
 
-    DEBUG_MSG("updates received (device_id: %i, count: %i)\n", updates->device_id, updates->count);
+    const int review = (handle->cycles_counter % CC_TIMING_WINDOW) == 0;
+    const int crowded = handle->airtime_peak * 4 > handle->sync_interval * 3;
 
-    for (int i = 0; i < updates->count; i++)
+    if (!review && !crowded)
+        return;
+
+    // every device may send a data update in each cycle
+    int64_t updates = devices_count() * airtime_us(handle, CC_UPDATE_FRAME_SIZE);
+
+    // twice the busiest cycle, in steps of 500 us
+    int64_t interval = 2 * (handle->airtime_peak + updates);
+    interval = (interval + 499) / 500 * 500;
+
+    if (interval < CC_SYNC_INTERVAL_MIN)
+        interval = CC_SYNC_INTERVAL_MIN;
+    else if (interval > CC_CHAIN_SYNC_INTERVAL)
+        interval = CC_CHAIN_SYNC_INTERVAL;
+
+    if (interval > handle->sync_interval || (review && interval < handle->sync_interval))
     {
-        cc_assignment_key_t assignment_key = {
-            .id = updates->list[i].assignment_id,
-            .device_id = updates->device_id,
-            .pair_id = -1,
-        };
+        DEBUG_MSG("sync interval %i us\n", (int) interval);
+        sync_interval_set(handle, interval);
+    }
 
-        cc_device_t *device = cc_device_get(updates->device_id);
-        if (!device)
-        {
-            DEBUG_MSG("updates for device_id %i, device id is invalid\n", updates->device_id);
-            continue;
-        }
+    // a reply may wait for the next cycle and for the other devices updates
+    int64_t timeout = 2 * handle->sync_interval + updates + airtime_us(handle, CC_REPLY_SIZE);
+    handle->response_timeout = timeout < CC_RESPONSE_TIMEOUT * 1000 ? timeout : CC_RESPONSE_TIMEOUT * 1000;
 
-        cc_assignment_t *assignment = cc_assignment_get(&assignment_key);
-        if (!assignment)
-        {
-            DEBUG_MSG("updates for device_id %i, assignment_id %i is invalid\n", updates->device_id, updates->list[i].assignment_id);
-            continue;
-        }
+    if (review)
+        handle->airtime_peak = 0;
+}
 
-        // change value
-        assignment->value = updates->list[i].value;
+// maximum time to wait for the next bytes according the receiver state (in ms)
+static unsigned int rx_timeout(const cc_handle_t *handle)
+{
+    // the rest of a frame shouldn't take much longer than its airtime
+    if (handle->auto_timing && (handle->state == WAITING_DATA || handle->state == WAITING_CRC))
+        return CC_HEADER_TIMEOUT + 2 * airtime_us(handle, handle->msg_rx->data_size + 1) / 1000;
 
-        // also change value of paired assignment
-        cc_assignment_t *pair_assignment = NULL;
+    return g_rx_timeouts[handle->state];
+}
 
-        cc_assignment_key_t assignment_pair_key = {
-            .id = assignment->assignment_pair_id,
-            .device_id = assignment->device_id,
-            .pair_id = -1,
-        };
+// event loop only: wait for the serial port to be writable while there is backlog
+static void tx_watch(cc_handle_t *handle)
+{
+    int watch = handle->tx_backlog_size > 0;
 
-        if (assignment_pair_key.id != -1)
-        {
-            pair_assignment = cc_assignment_get(&assignment_pair_key);
+    if (handle->engine != CC_ENGINE_EVENT_LOOP || !handle->serial_enabled || watch == handle->tx_watching)
+        return;
+
+    struct epoll_event event = {
+        .events = watch ? EPOLLIN | EPOLLOUT : EPOLLIN,
+        .data.u32 = CC_EVENT_SERIAL
+    };
+
+    if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_MOD, handle->serial_fd, &event) == 0)
+        handle->tx_watching = watch;
+}
+
+// write the queued frames, must be called with the sending lock held
+static void tx_flush_locked(cc_handle_t *handle)
+{
+    if (!handle->serial_enabled)
+    {
+        handle->tx_iovcnt = handle->tx_frames = handle->tx_pending = handle->tx_cobs_size = handle->tx_arena_size = 0;
+        return;
+    }
+
+    int ret;
+
+    // bytes left from previous writes go first
+    if (handle->tx_backlog_size > 0)
+    {
+        struct iovec backlog = {handle->tx_backlog, handle->tx_backlog_size};
+        ret = handle->transport.ops->write(&handle->transport, &backlog, 1);
+        if (ret > 0)
+        {
+            handle->tx_backlog_size -= ret;
+            memmove(handle->tx_backlog, &handle->tx_backlog[ret], handle->tx_backlog_size);
+            __atomic_fetch_add(&handle->cycle_tx_bytes, ret, __ATOMIC_RELAXED);
+            handle->tx_writes++;
+        }
+    }
+
+    if (handle->tx_frames > 0)
+    {
+        int total = 0;
+        for (int i = 0; i < handle->tx_iovcnt; i++)
+            total += handle->tx_iov[i].iov_len;
+
+        // frames can't overtake the backlog
+        const int backlogged = handle->tx_backlog_size > 0;
+
+        ret = 0;
+        if (!backlogged)
+        {
+            ret = handle->transport.ops->write(&handle->transport, handle->tx_iov, handle->tx_iovcnt);
+            handle->tx_stats.writes++;
+
+            if (ret > 0)
+            {
+                __atomic_fetch_add(&handle->cycle_tx_bytes, ret, __ATOMIC_RELAXED);
+                handle->tx_writes++;
+            }
+        }
+
+        if (ret < 0)
+        {
+            // check for input/output error
+            // this error may happen when the serial file descriptor isn't
+            // valid anymore (e.g.: usb-serial device was been removed)
+            // the thread reading the port closes and reopens it
+            if (errno == EIO)
+            {
+                handle->serial_enabled = 0;
+                handle->tx_iovcnt = handle->tx_frames = handle->tx_pending = handle->tx_cobs_size = handle->tx_arena_size = 0;
+                return;
+            }
+
+            ret = 0;
+        }
+
+        // keep whatever the driver didn't take, it's written on the next flush
+        // it always fits, the frames are only queued if the backlog can hold them, see tx_room()
+        if (ret < total)
+        {
+            if (!backlogged)
+                handle->tx_stats.partial_writes++;
+
+            if (handle->tx_backlog_size + total - ret <= CC_TX_BACKLOG_SIZE)
+            {
+                for (int i = 0; i < handle->tx_iovcnt; i++)
+                {
+                    int len = handle->tx_iov[i].iov_len;
+                    const uint8_t *base = handle->tx_iov[i].iov_base;
+
+                    if (ret >= len)
+                    {
+                        ret -= len;
+                        continue;
+                    }
+
+                    memcpy(&handle->tx_backlog[handle->tx_backlog_size], base + ret, len - ret);
+                    handle->tx_backlog_size += len - ret;
+                    ret = 0;
+                }
+            }
+            else
+            {
+                handle->tx_stats.dropped_frames += handle->tx_frames;
+            }
+        }
+
+        handle->tx_stats.frames += handle->tx_frames;
+        handle->tx_iovcnt = handle->tx_frames = handle->tx_pending = handle->tx_cobs_size = handle->tx_arena_size = 0;
+    }
+
+    tx_watch(handle);
+}
+
+static void tx_flush(cc_handle_t *handle)
+{
+    pthread_mutex_lock(&handle->sending);
+    tx_flush_locked(handle);
+    pthread_mutex_unlock(&handle->sending);
+}
+
+// bytes a message takes on the line
+static int tx_frame_size(const cc_handle_t *handle, const cc_msg_t *msg)
+{
+    int size = CC_MSG_HEADER_SIZE + msg->data_size + 1;
+
+    if (handle->framing == CC_FRAMING_COBS)
+        return COBS_ENCODED_SIZE(size);
+
+    return size + 1;
+}
+
+// whether a frame of the given size can be queued, if the backlog couldn't hold it along with
+// the queued frames, these are flushed first
+// returns 0 if it still doesn't fit (the line is stalled), the frame must not be queued then
+static int tx_room(cc_handle_t *handle, int frame_size)
+{
+    if (handle->tx_backlog_size + handle->tx_pending + frame_size > CC_TX_BACKLOG_SIZE)
+        tx_flush_locked(handle);
+
+    if (handle->tx_backlog_size + handle->tx_pending + frame_size > CC_TX_BACKLOG_SIZE)
+    {
+        handle->tx_stats.dropped_frames++;
+        return 0;
+    }
+
+    return 1;
+}
+
+// sync byte and header of a frame
+static void tx_header(uint8_t *header, const cc_msg_t *msg)
+{
+    header[0] = CC_SYNC_BYTE;
+    header[1] = msg->device_id;
+    header[2] = msg->command;
+    header[3] = (msg->data_size >> 0) & 0xFF;
+    header[4] = (msg->data_size >> 8) & 0xFF;
+}
+
+// queue a frame to be written on the next flush
+// the message data is referenced, not copied, so it must be kept until then
+// returns -1 if the frame was not queued because the line is stalled
+static int tx_append(cc_handle_t *handle, const cc_msg_t *msg)
+{
+    if (!handle || !msg || !handle->serial_enabled)
+        return -1;
+
+    pthread_mutex_lock(&handle->sending);
+
+    // out of frame slots or of room for the encoded frame
+    const int cobs = handle->framing == CC_FRAMING_COBS;
+    const int frame_size = tx_frame_size(handle, msg);
+    if (handle->tx_frames == CC_TX_FRAMES_MAX || (cobs && handle->tx_cobs_size + frame_size > CC_TX_BACKLOG_SIZE))
+        tx_flush_locked(handle);
+
+    if (!tx_room(handle, frame_size))
+    {
+        pthread_mutex_unlock(&handle->sending);
+        DEBUG_MSG("transmit backlog full, frame dropped (command: %i)\n", msg->command);
+        return -1;
+    }
+
+    // sync byte and header
+    uint8_t *header = handle->tx_headers[handle->tx_frames];
+    tx_header(header, msg);
+
+    // calculate crc (skip sync byte)
+    uint8_t *crc = &handle->tx_crcs[handle->tx_frames];
+    *crc = crc8(&header[1], CC_MSG_HEADER_SIZE);
+    *crc = crc8_update(*crc, msg->data, msg->data_size);
+
+    // data is written straight from the message
+    struct iovec *iov = &handle->tx_iov[handle->tx_iovcnt];
+    iov[0] = (struct iovec) {header, CC_MSG_HEADER_SIZE + 1};
+    iov[1] = (struct iovec) {msg->data, msg->data_size};
+    iov[2] = (struct iovec) {crc, 1};
+
+    if (cobs)
+    {
+        // the sync byte is replaced by the delimiter
+        iov[0] = (struct iovec) {&header[1], CC_MSG_HEADER_SIZE};
+
+        uint8_t *frame = &handle->tx_cobs[handle->tx_cobs_size];
+        int size = cobs_encode(iov, 3, frame);
+        handle->tx_cobs_size += size;
+
+        iov[0] = (struct iovec) {frame, size};
+        handle->tx_iovcnt += 1;
+    }
+    else
+    {
+        handle->tx_iovcnt += 3;
+    }
+
+    handle->tx_frames++;
+    handle->tx_pending += frame_size;
+
+    pthread_mutex_unlock(&handle->sending);
+
+    // print message if debug is enabled
+    cc_msg_print("SEND", msg);
+
+    return 0;
+}
+
+// build a message straight into a frame of the arena, header and crc are filled in place
+// it's written on the next flush
+static int tx_append_build(cc_handle_t *handle, int device_id, int command, const void *data_struct)
+{
+    if (!handle || !handle->serial_enabled)
+        return -1;
+
+    // sync byte, header, data and crc
+    const int frame_size = CC_MSG_HEADER_SIZE + cc_msg_data_size(command, data_struct) + 2;
+    if (frame_size > CC_TX_ARENA_SIZE)
+    {
+        DEBUG_MSG("message too big (command: %i)\n", command);
+        return -1;
+    }
+
+    pthread_mutex_lock(&handle->sending);
+
+    // out of frame slots or of room for the frame
+    const int cobs = handle->framing == CC_FRAMING_COBS;
+    if (handle->tx_frames == CC_TX_FRAMES_MAX || handle->tx_arena_size + frame_size > CC_TX_ARENA_SIZE ||
+        (cobs && handle->tx_cobs_size + COBS_ENCODED_SIZE(frame_size - 1) > CC_TX_BACKLOG_SIZE))
+        tx_flush_locked(handle);
+
+    if (!tx_room(handle, cobs ? COBS_ENCODED_SIZE(frame_size - 1) : frame_size))
+    {
+        pthread_mutex_unlock(&handle->sending);
+        DEBUG_MSG("transmit backlog full, frame dropped (command: %i)\n", command);
+        return -1;
+    }
+
+    uint8_t *frame = &handle->tx_arena[handle->tx_arena_size];
+    cc_msg_t msg = {.header = &frame[1], .data = &frame[1 + CC_MSG_HEADER_SIZE]};
+    cc_msg_encode(&msg, device_id, command, data_struct);
+
+    tx_header(frame, &msg);
+    frame[frame_size - 1] = crc8(&frame[1], frame_size - 2);
+
+    struct iovec *iov = &handle->tx_iov[handle->tx_iovcnt++];
+
+    if (cobs)
+    {
+        // the sync byte is replaced by the delimiter
+        struct iovec raw = {&frame[1], frame_size - 1};
+        uint8_t *encoded = &handle->tx_cobs[handle->tx_cobs_size];
+        int size = cobs_encode(&raw, 1, encoded);
+        handle->tx_cobs_size += size;
+
+        *iov = (struct iovec) {encoded, size};
+    }
+    else
+    {
+        *iov = (struct iovec) {frame, frame_size};
+    }
+
+    handle->tx_arena_size += frame_size;
+    handle->tx_pending += iov->iov_len;
+    handle->tx_frames++;
+
+    pthread_mutex_unlock(&handle->sending);
+
+    // print message if debug is enabled
+    cc_msg_print("SEND", &msg);
+
+    return 0;
+}
+
+static void tx_append_sync(cc_handle_t *handle, uint8_t cycle)
+{
+    pthread_mutex_lock(&handle->sending);
+
+    if (handle->tx_frames == CC_TX_FRAMES_MAX)
+        tx_flush_locked(handle);
+
+    struct iovec iov = {handle->sync_frames[cycle], CC_SYNC_FRAME_SIZE};
+    if (handle->framing == CC_FRAMING_COBS)
+        iov = (struct iovec) {handle->sync_frames_cobs[cycle], handle->sync_frames_cobs_size[cycle]};
+
+    if (tx_room(handle, iov.iov_len))
+    {
+        handle->tx_iov[handle->tx_iovcnt++] = iov;
+        handle->tx_pending += iov.iov_len;
+        handle->tx_frames++;
+    }
+
+    pthread_mutex_unlock(&handle->sending);
+}
+
+static void send(cc_handle_t *handle, const cc_msg_t *msg)
+{
+    tx_append(handle, msg);
+    tx_flush(handle);
+}
+
+// add a request which expects a reply, it must be done before the request is sent
+// waited entries are released by inflight_wait(), the others when replied or expired
+static cc_inflight_t* inflight_add(cc_handle_t *handle, int device_id, int command, int waited)
+{
+    cc_inflight_t *entry = NULL;
+
+    pthread_mutex_lock(&handle->inflight_lock);
+
+    for (int i = 0; i < CC_INFLIGHT_MAX; i++)
+    {
+        cc_inflight_t *inflight = &handle->inflight[i];
+
+        // a new request replaces the previous one with the same key
+        if (inflight->device_id == device_id && inflight->command == command)
+        {
+            entry = inflight;
+            break;
+        }
+
+        if (!entry && inflight->device_id == 0)
+            entry = inflight;
+    }
+
+    if (entry)
+    {
+        entry->device_id = device_id;
+        entry->command = command;
+        entry->waited = waited;
+        entry->sent = clock_us();
+        entry->deadline = entry->sent + handle->response_timeout;
+
+        // discard a reply posted after a previous wait gave up
+        while (sem_trywait(&entry->reply) == 0);
+    }
+
+    pthread_mutex_unlock(&handle->inflight_lock);
+
+    return entry;
+}
+
+// push the deadline of a request once the header of its reply announced the reply size
+// only that request is extended, the bytes of other devices don't keep a silent one alive
+static void inflight_extend(cc_handle_t *handle, int device_id, int command, int64_t deadline)
+{
+    pthread_mutex_lock(&handle->inflight_lock);
+
+    for (int i = 0; i < CC_INFLIGHT_MAX; i++)
+    {
+        cc_inflight_t *entry = &handle->inflight[i];
+
+        if (entry->device_id == device_id && entry->command == command)
+        {
+            if (entry->deadline < deadline)
+                entry->deadline = deadline;
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&handle->inflight_lock);
+}
+
+// route a reply to its request
+// returns when the request was sent or 0 if nobody is waiting for such reply
+static int64_t inflight_reply(cc_handle_t *handle, int device_id, int command)
+{
+    int64_t sent = 0;
+
+    pthread_mutex_lock(&handle->inflight_lock);
+
+    for (int i = 0; i < CC_INFLIGHT_MAX; i++)
+    {
+        cc_inflight_t *entry = &handle->inflight[i];
+
+        if (entry->device_id == device_id && entry->command == command)
+        {
+            sent = entry->sent;
+
+            if (entry->waited)
+                sem_post(&entry->reply);
+            else
+                entry->device_id = 0;
+
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&handle->inflight_lock);
+
+    return sent;
+}
+
+// wait for the reply until the entry deadline and release the entry
+// returns 0 if the reply was received
+static int inflight_wait(cc_handle_t *handle, cc_inflight_t *entry)
+{
+    int ret = 1;
+
+    for (;;)
+    {
+        // the entries of a window are waited one after the other, the reply may already be
+        // there even if the deadline has passed meanwhile
+        if (sem_trywait(&entry->reply) == 0)
+        {
+            ret = 0;
+            break;
+        }
+
+        // the deadline moves while the reply is being received
+        pthread_mutex_lock(&handle->inflight_lock);
+        int64_t remaining = entry->deadline - clock_us();
+        pthread_mutex_unlock(&handle->inflight_lock);
+
+        if (remaining <= 0)
+            break;
+
+        // semaphores wait on the realtime clock
+        struct timespec timeout;
+        clock_gettime(CLOCK_REALTIME, &timeout);
+
+        timeout.tv_sec += remaining / 1000000;
+        timeout.tv_nsec += (remaining % 1000000) * 1000;
+
+        if (timeout.tv_nsec >= 1000000000)
+        {
+            timeout.tv_sec += 1;
+            timeout.tv_nsec -= 1000000000;
+        }
+
+        if (sem_timedwait(&entry->reply, &timeout) == 0)
+        {
+            ret = 0;
+            break;
+        }
+
+        int e = errno;
+        if (e != EINTR && e != ETIMEDOUT)
+        {
+            DEBUG_MSG("timedwait error %d\n", e);
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&handle->inflight_lock);
+    entry->device_id = 0;
+    pthread_mutex_unlock(&handle->inflight_lock);
+
+    // the reply may have been routed right before the entry was released
+    if (ret && sem_trywait(&entry->reply) == 0)
+        ret = 0;
+
+    return ret;
+}
+
+// release a not waited entry of the given command past its deadline
+// returns the device id of the expired entry or 0 if none
+static int inflight_expire(cc_handle_t *handle, int command)
+{
+    int device_id = 0;
+    const int64_t now = clock_us();
+
+    pthread_mutex_lock(&handle->inflight_lock);
+
+    for (int i = 0; i < CC_INFLIGHT_MAX; i++)
+    {
+        cc_inflight_t *entry = &handle->inflight[i];
+
+        if (entry->device_id && !entry->waited && entry->command == command &&
+            now >= entry->deadline)
+        {
+            device_id = entry->device_id;
+            entry->device_id = 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&handle->inflight_lock);
+
+    return device_id;
+}
+
+static void sync_frames_setup(cc_handle_t *handle)
+{
+    for (int cycle = 0; cycle < CC_SYNC_CYCLES; cycle++)
+    {
+        uint8_t *frame = handle->sync_frames[cycle];
+
+        frame[0] = CC_SYNC_BYTE;
+        frame[1] = 0;
+        frame[2] = CC_CMD_CHAIN_SYNC;
+        frame[3] = 1;
+        frame[4] = 0;
+        frame[5] = cycle;
+        frame[6] = crc8(&frame[1], CC_MSG_HEADER_SIZE + 1);
+
+        // same frame without the sync byte
+        struct iovec iov = {&frame[1], CC_SYNC_FRAME_SIZE - 1};
+        handle->sync_frames_cobs_size[cycle] = cobs_encode(&iov, 1, handle->sync_frames_cobs[cycle]);
+    }
+}
+
+static void send_sync(cc_handle_t *handle, uint8_t cycle)
+{
+    tx_append_sync(handle, cycle);
+    tx_flush(handle);
+}
+
+// queue a device descriptor request, it's written on the next flush
+// the threads engine waits for the reply with inflight_wait(), the event loop gets it from the parser
+static cc_inflight_t* descriptor_request(cc_handle_t *handle, int device_id)
+{
+    cc_msg_t dev_desc_msg = {
+        .device_id = device_id,
+        .command = CC_CMD_DEV_DESCRIPTOR,
+        .data_size = sizeof (g_descriptor_request),
+        .data = (uint8_t *) &g_descriptor_request
+    };
+
+    // the reply is also used to measure the round trip time
+    cc_inflight_t *entry = inflight_add(handle, device_id, CC_CMD_DEV_DESCRIPTOR,
+        handle->engine == CC_ENGINE_THREADS);
+
+    // not sent, it's requested again on the next requests cycle
+    if (tx_append(handle, &dev_desc_msg) && entry)
+    {
+        pthread_mutex_lock(&handle->inflight_lock);
+        entry->device_id = 0;
+        pthread_mutex_unlock(&handle->inflight_lock);
+        return NULL;
+    }
+
+    return entry;
+}
+
+// broadcast the new link settings and switch once the request left the wire
+// returns -1 if the settings couldn't be queued, the link is left as it is
+static int link_switch(cc_handle_t *handle, int baudrate, int framing)
+{
+    cc_link_setup_t setup = {.baudrate = baudrate, .framing = framing};
+    if (tx_append_build(handle, 0, CC_CMD_LINK_SETUP, &setup))
+        return -1;
+
+    // wait the backlog, if any, then the transmission itself
+    // the sending lock is only held to flush, other contexts keep appending meanwhile
+    const cc_transport_ops_t *ops = handle->transport.ops;
+    unsigned int writes;
+    int backlog;
+    do
+    {
+        pthread_mutex_lock(&handle->sending);
+        tx_flush_locked(handle);
+        backlog = handle->serial_enabled ? handle->tx_backlog_size : 0;
+        writes = handle->tx_writes;
+        pthread_mutex_unlock(&handle->sending);
+
+        if (backlog > 0)
+        {
+            struct pollfd pfd = {.fd = handle->serial_fd, .events = POLLOUT};
+            if (poll(&pfd, 1, CC_SERIAL_WAIT_TIMEOUT) <= 0)
+                break;
+        }
+    } while (backlog > 0);
+
+    if (handle->serial_enabled && ops->drain)
+        ops->drain(&handle->transport);
+
+    pthread_mutex_lock(&handle->sending);
+    if (handle->serial_enabled)
+    {
+        // frames appended since the last flush still go at the old rate and framing
+        // they are few, the port was just drained
+        tx_flush_locked(handle);
+        while (ops->drain && handle->tx_writes != writes)
+        {
+            writes = handle->tx_writes;
+            ops->drain(&handle->transport);
+            tx_flush_locked(handle);
+        }
+
+        if (ops->set_baudrate)
+            ops->set_baudrate(&handle->transport, baudrate);
+    }
+    handle->framing = framing;
+    handle->line_baudrate = baudrate;
+    pthread_mutex_unlock(&handle->sending);
+
+    handle->link_cycle = handle->link_window = handle->cycles_counter;
+    handle->link_errors = handle->link_frames = 0;
+
+    pthread_mutex_lock(&handle->stats_lock);
+    handle->link_stats.baudrate = baudrate;
+    handle->link_stats.framing = framing;
+    pthread_mutex_unlock(&handle->stats_lock);
+
+    DEBUG_MSG("link changed to %i bps, framing %i\n", baudrate, framing);
+
+    return 0;
+}
+
+// the label is set when the descriptor is swapped in, see cc_device_lock()
+static bool device_registered(cc_device_t *device)
+{
+    cc_device_lock();
+    bool registered = device->label != NULL;
+    cc_device_unlock();
+
+    return registered;
+}
+
+// the current page is reset along with the descriptor
+static int device_page(cc_device_t *device)
+{
+    cc_device_lock();
+    int page = device->current_page;
+    cc_device_unlock();
+
+    return page;
+}
+
+// all devices are registered and understand the link setup command
+static int link_capable(void)
+{
+    int devices = 0;
+
+    for (int i = 1; i <= CC_MAX_DEVICES; i++)
+    {
+        cc_device_t *device = cc_device_get(i);
+        if (!device)
+            continue;
+
+        if (!device_registered(device) || !cc_handshake_link_capable(&device->protocol))
+            return 0;
+
+        devices++;
+    }
+
+    return devices > 0;
+}
+
+// negotiate the link baud rate and framing, must be called on request cycles
+// returns 1 if the request window was used to change the link
+static int link_cycle(cc_handle_t *handle)
+{
+    int baudrate = handle->link_baudrate > handle->baudrate ? handle->link_baudrate : handle->baudrate;
+
+    if ((baudrate == handle->baudrate && handle->link_framing == CC_FRAMING_RAW) ||
+        handle->link_state == CC_LINK_FAILED)
+        return 0;
+
+    unsigned int cycles = handle->cycles_counter - handle->link_cycle;
+
+    if (handle->link_state == CC_LINK_DEFAULT)
+    {
+        // wait the chain to be quiet, no handshakes for a couple of handshake cycles
+        if (cycles < 2*CC_HANDSHAKE_PERIOD || !link_capable())
+            return 0;
+
+        // tried again on the next request cycle
+        if (link_switch(handle, baudrate, handle->link_framing))
+            return 0;
+
+        handle->link_state = CC_LINK_VERIFYING;
+
+        return 1;
+    }
+
+    // devices timed out or were removed, they come back at the default rate
+    if (!link_capable())
+    {
+        if (link_switch(handle, handle->baudrate, CC_FRAMING_RAW))
+            return 0;
+
+        handle->link_state = CC_LINK_DEFAULT;
+
+        return 1;
+    }
+
+    unsigned int window = handle->cycles_counter - handle->link_window;
+
+    // frames failing crc, or no confirmation at all, at the new rate
+    if (handle->link_errors >= CC_LINK_ERRORS_MAX || (handle->link_state == CC_LINK_VERIFYING &&
+        window >= CC_LINK_VERIFY_CYCLES && handle->link_frames == 0))
+    {
+        DEBUG_MSG("link failed at %i bps, framing %i (errors: %u, frames: %u)\n",
+            baudrate, handle->link_framing, handle->link_errors, handle->link_frames);
+
+        if (link_switch(handle, handle->baudrate, CC_FRAMING_RAW))
+            return 0;
+
+        handle->link_state = CC_LINK_FAILED;
+
+        pthread_mutex_lock(&handle->stats_lock);
+        handle->link_stats.fallbacks++;
+        pthread_mutex_unlock(&handle->stats_lock);
+
+        return 1;
+    }
+
+    if (window < CC_LINK_VERIFY_CYCLES)
+        return 0;
+
+    if (handle->link_state == CC_LINK_VERIFYING)
+    {
+        handle->link_state = CC_LINK_UPGRADED;
+
+        pthread_mutex_lock(&handle->stats_lock);
+        handle->link_stats.upgrades++;
+        pthread_mutex_unlock(&handle->stats_lock);
+    }
+
+    // devices plugged after the upgrade only talk at the default rate
+    if (cycles >= CC_LINK_RESCAN_PERIOD)
+    {
+        if (link_switch(handle, handle->baudrate, CC_FRAMING_RAW))
+            return 0;
+
+        handle->link_state = CC_LINK_DEFAULT;
+
+        return 1;
+    }
+
+    // errors are counted per window
+    handle->link_window = handle->cycles_counter;
+    handle->link_errors = handle->link_frames = 0;
+
+    return 0;
+}
+
+static void completion_start(cc_completion_t *completion)
+{
+    if (!completion)
+        return;
+
+    completion->done = 0;
+    completion->ret = 0;
+    completion->queued = clock_us();
+    completion->sent = completion->completed = 0;
+}
+
+static void completion_done(cc_completion_t *completion, int ret)
+{
+    if (!completion)
+        return;
+
+    completion->ret = ret;
+    completion->completed = clock_us();
+
+    if (!completion->sent)
+        completion->sent = completion->completed;
+
+    // the caller may be polling, the callback may reuse the completion
+    __atomic_store_n(&completion->done, 1, __ATOMIC_RELEASE);
+
+    if (completion->callback)
+        completion->callback(completion);
+}
+
+static void request_done(cc_request_t *req, int ret)
+{
+    if (req->detached)
+    {
+        completion_done(req->completion, ret);
+        cc_msg_delete(req->msg);
+        free(req);
+        return;
+    }
+
+    req->ret = ret;
+    sem_post(&req->done);
+}
+
+// value updates only carry the latest state of an actuator, a newer one makes the queued one useless
+// both start with the assignment id and the actuator id
+static int request_supersedes(const cc_msg_t *msg, const cc_msg_t *queued)
+{
+    if (msg->command != CC_CMD_SET_VALUE && msg->command != CC_CMD_UPDATE_ENUMERATION)
+        return 0;
+
+    return msg->command == queued->command && msg->device_id == queued->device_id &&
+        msg->data_size >= 2 && queued->data_size >= 2 &&
+        msg->data[0] == queued->data[0] && msg->data[1] == queued->data[1];
+}
+
+static void request_queue(cc_handle_t *handle, cc_request_t *req)
+{
+    int priority = CC_PRIORITY_NORMAL;
+    if (req->msg->command == CC_CMD_SET_VALUE || req->msg->command == CC_CMD_UPDATE_ENUMERATION)
+        priority = CC_PRIORITY_HIGH;
+
+    req->ret = 0;
+    req->next = NULL;
+
+    pthread_mutex_lock(&handle->request_lock);
+
+    // last write wins, the new request takes the place of the one it supersedes
+    cc_request_t *superseded = NULL;
+    for (cc_request_t **link = &handle->requests[priority]; *link; link = &(*link)->next)
+    {
+        if (request_supersedes(req->msg, (*link)->msg))
+        {
+            superseded = *link;
+            req->next = superseded->next;
+            *link = req;
+            if (handle->requests_tail[priority] == superseded)
+                handle->requests_tail[priority] = req;
+            break;
+        }
+    }
+
+    // or goes to the end of the requests queue
+    if (!superseded)
+    {
+        if (handle->requests_tail[priority])
+            handle->requests_tail[priority]->next = req;
+        else
+            handle->requests[priority] = req;
+        handle->requests_tail[priority] = req;
+        handle->requests_count++;
+    }
+
+    pthread_mutex_unlock(&handle->request_lock);
+
+    // what it carried goes out with the new request
+    if (superseded)
+    {
+        pthread_mutex_lock(&handle->sending);
+        handle->tx_stats.coalesced++;
+        pthread_mutex_unlock(&handle->sending);
+
+        request_done(superseded, 0);
+    }
+
+    // wake up event loop
+    if (handle->engine == CC_ENGINE_EVENT_LOOP)
+    {
+        uint64_t value = 1;
+        if (write(handle->event_fd, &value, sizeof(value)) < 0)
+            DEBUG_MSG("failed to notify event loop\n");
+    }
+    else
+    {
+        sync_requests(handle);
+    }
+}
+
+// queue a request without waiting for it, the request takes the ownership of the message
+// the message may be NULL (it could not be allocated), the request then completes with an error
+static int request_detached(cc_handle_t *handle, cc_msg_t *msg, cc_completion_t *completion)
+{
+    cc_request_t *req = msg ? malloc(sizeof(cc_request_t)) : NULL;
+    if (!req)
+    {
+        DEBUG_MSG("failed to allocate request\n");
+        cc_msg_delete(msg);
+        completion_done(completion, -1);
+        return -1;
+    }
+
+    req->msg = msg;
+    req->detached = 1;
+    req->completion = completion;
+
+    request_queue(handle, req);
+
+    return 0;
+}
+
+static int request(cc_handle_t *handle, const cc_msg_t *msg)
+{
+    // the event loop cannot wait for itself (e.g.: the blocking API called from a callback)
+    // such requests are queued with a copy of the message and return immediately
+    if (handle->engine == CC_ENGINE_EVENT_LOOP && pthread_equal(pthread_self(), handle->event_loop_thread))
+    {
+        return request_detached(handle, cc_msg_dup(msg), NULL);
+    }
+
+    cc_request_t req;
+    req.msg = (cc_msg_t *) msg;
+    req.detached = 0;
+    req.completion = NULL;
+    sem_init(&req.done, 0, 0);
+
+    request_queue(handle, &req);
+
+    // wait for the requests cycle
+    while (sem_wait(&req.done) && errno == EINTR);
+    sem_destroy(&req.done);
+
+    return req.ret;
+}
+
+// pop the request with the highest priority which fits the given size
+static cc_request_t* request_pop(cc_handle_t *handle, int max_size)
+{
+    cc_request_t *req = NULL;
+
+    pthread_mutex_lock(&handle->request_lock);
+
+    for (int priority = 0; priority < CC_PRIORITIES; priority++)
+    {
+        req = handle->requests[priority];
+        if (!req)
+            continue;
+
+        // requests of the same priority keep their order
+        if (tx_frame_size(handle, req->msg) > max_size)
+        {
+            req = NULL;
+            continue;
+        }
+
+        handle->requests[priority] = req->next;
+        if (!handle->requests[priority])
+            handle->requests_tail[priority] = NULL;
+        handle->requests_count--;
+        break;
+    }
+
+    pthread_mutex_unlock(&handle->request_lock);
+
+    return req;
+}
+
+// airtime budget of a requests window, in us
+static int64_t requests_airtime(const cc_handle_t *handle)
+{
+    if (handle->sync_interval >= CC_CHAIN_SYNC_INTERVAL)
+        return CC_REQUESTS_AIRTIME;
+
+    return (int64_t) CC_REQUESTS_AIRTIME * handle->sync_interval / CC_CHAIN_SYNC_INTERVAL;
+}
+
+// queue as many requests as the window airtime allows, returns how many
+// the first request always goes, even if it alone takes longer than the window
+static int requests_append(cc_handle_t *handle, cc_request_t **reqs)
+{
+    int count = 0;
+    int budget = (int64_t) handle->line_baudrate * requests_airtime(handle) / 10 / 1000000;
+
+    while (count < CC_REQUESTS_MAX)
+    {
+        cc_request_t *req = request_pop(handle, count ? budget : INT_MAX);
+        if (!req)
+            break;
+
+        // the line is stalled or down, the request fails rather than being truncated on the wire
+        if (tx_append(handle, req->msg))
+        {
+            request_done(req, -1);
+            break;
+        }
+
+        budget -= tx_frame_size(handle, req->msg);
+        reqs[count++] = req;
+
+        if (req->completion)
+            req->completion->sent = clock_us();
+    }
+
+    if (count > 0)
+    {
+        pthread_mutex_lock(&handle->sending);
+        handle->tx_stats.requests += count;
+        handle->tx_stats.request_windows++;
+        pthread_mutex_unlock(&handle->sending);
+    }
+
+    return count;
+}
+
+static int requests_pending(cc_handle_t *handle)
+{
+    pthread_mutex_lock(&handle->request_lock);
+    int count = handle->requests_count;
+    pthread_mutex_unlock(&handle->request_lock);
+
+    return count;
+}
+
+// whether the current (not handshake) cycle carries requests
+static int requests_cycle(cc_handle_t *handle)
+{
+    // regular requests window, unless the link negotiation takes it
+    if ((handle->cycles_counter % CC_REQUESTS_PERIOD) == 0)
+        return !link_cycle(handle);
+
+    // extra window for the requests queued since the last one
+    return requests_pending(handle) > 0;
+}
+
+static void requests_done(cc_request_t **reqs, int count)
+{
+    for (int i = 0; i < count; i++)
+        request_done(reqs[i], 0);
+}
+
+// cycle of an idle chain, it looks for new devices and still serves the requests queue, so
+// the callers (e.g.: disabling a device which just left) don't wait for a device to show up
+static void idle_cycle(cc_handle_t *handle)
+{
+    cc_request_t *reqs[CC_REQUESTS_MAX];
+
+    tx_append_sync(handle, CC_SYNC_HANDSHAKE_CYCLE);
+    int reqs_count = requests_append(handle, reqs);
+    tx_flush(handle);
+
+    requests_done(reqs, reqs_count);
+
+    // what didn't fit goes on the next cycle, at the regular cadence
+    if (requests_pending(handle))
+    {
+        handle->sync_deadline = clock_us() + CC_CHAIN_SYNC_INTERVAL;
+
+        if (handle->engine == CC_ENGINE_EVENT_LOOP)
+            sync_timer_set(handle);
+    }
+}
+
+// send a request and wait for it or, if async, just queue it
+// the message is consumed in both cases, a NULL message (not built) fails the request
+static int request_send(cc_handle_t *handle, cc_msg_t *msg, bool async, cc_completion_t *completion)
+{
+    if (!msg)
+    {
+        DEBUG_MSG("message could not be built\n");
+        completion_done(completion, -1);
+        return -1;
+    }
+
+    if (async)
+        return request_detached(handle, msg, completion);
+
+    int ret = request(handle, msg);
+    cc_msg_delete(msg);
+
+    return ret;
+}
+
+static int assignment_request(cc_handle_t *handle, cc_assignment_t *assignment, bool new_assignment,
+    bool async, cc_completion_t *completion)
+{
+    completion_start(completion);
+
+    cc_device_t *device = cc_device_get(assignment->device_id);
+
+    if (!device)
+    {
+        completion_done(completion, -1);
+        return -1;
+    }
+
+    if (new_assignment)
+    {
+        // the actuators are part of the descriptor, which may be replaced meanwhile
+        cc_device_lock();
+
+        const int actuators_per_page = device->actuators_count + device->actuatorgroups_count;
+
+        // check if we need to save enumeration stuff
+        if (actuators_per_page && (assignment->mode & CC_MODE_OPTIONS) && device->enumeration_frame_item_count)
+            cc_assignment_update_list(assignment, assignment->value);
+
+        cc_device_unlock();
+
+        // the device isn't registered (yet)
+        if (!actuators_per_page)
+        {
+            completion_done(completion, -1);
+            return -1;
+        }
+
+        // set page id
+        assignment->actuator_page_id = assignment->actuator_id / actuators_per_page;
+
+        // add assignment
+        assignment->id = cc_assignment_add(assignment);
+    }
+
+    if (assignment->id < 0)
+    {
+        completion_done(completion, -1);
+        return -1;
+    }
+
+    // enforce initial value for momentary-mode assignments
+    if (assignment->mode & CC_MODE_MOMENTARY)
+        assignment->value = assignment->mode & CC_MODE_REVERSE ? assignment->max : assignment->min;
+
+    // we only send the actuators of the current page
+    if (device_page(device) != assignment->actuator_page_id)
+    {
+        completion_done(completion, 0);
+        return assignment->id;
+    }
+
+    device->timeout = 0;
+
+    cc_msg_t *msg = cc_msg_builder(assignment->device_id, CC_CMD_ASSIGNMENT, assignment);
+
+    // too big to be sent, the device would never know about the new assignment
+    if (!msg && new_assignment)
+    {
+        DEBUG_MSG("  assignment could not be built (id: %i)\n", assignment->id);
+
+        cc_assignment_key_t key = {assignment->id, assignment->device_id, -1};
+        cc_assignment_remove(&key);
+
+        completion_done(completion, -1);
+        return -1;
+    }
+
+    if (request_send(handle, msg, async, completion))
+    {
+        // TODO: if timeout, try at least one more time
+        DEBUG_MSG("  assignment timeout (id: %i)\n", assignment->id);
+    }
+    else
+    {
+        DEBUG_MSG("  assignment %s (id: %i)\n", async ? "queued" : "done", assignment->id);
+    }
+
+    if (!async)
+        device->timeout = 0;
+
+    return assignment->id;
+}
+
+static void unassignment_request(cc_handle_t *handle, cc_assignment_key_t *assignment_key,
+    bool async, cc_completion_t *completion)
+{
+    completion_start(completion);
+
+    cc_device_t *device = cc_device_get(assignment_key->device_id);
+    cc_assignment_t *assignment = cc_assignment_get(assignment_key);
+
+    const cc_assignment_key_t assignment_pair_key = {
+        assignment_key->pair_id, assignment_key->device_id, -1
+    };
+
+    const bool assignment_active = device && assignment && device_page(device) == assignment->actuator_page_id;
+
+    int ret = cc_assignment_remove(assignment_key);
+
+    DEBUG_MSG("unassignment received (id: %i, ret: %i)\n", assignment_key->id, ret);
+
+    if (ret < 0)
+    {
+        completion_done(completion, -1);
+        return;
+    }
+
+    if (assignment_pair_key.id != -1)
+    {
+        ret = cc_assignment_remove(&assignment_pair_key);
+
+        DEBUG_MSG("group unassignment received (id: %i, ret: %i)\n", assignment_pair_key.id, ret);
+
+        if (ret < 0)
+        {
+            completion_done(completion, -1);
+            return;
+        }
+    }
+
+    if (!assignment_active)
+    {
+        completion_done(completion, 0);
+        return;
+    }
+
+    DEBUG_MSG("  requesting unassignment to device (id: %i)\n", assignment_key->id);
+
+    device->timeout = 0;
+
+    // requests of the same priority keep their order, so the completion goes with the last one
+    const bool pair = assignment_pair_key.id != -1;
+
+    // request unassignment
+    cc_msg_t *msg = cc_msg_builder(assignment_key->device_id, CC_CMD_UNASSIGNMENT, assignment_key);
+    if (request_send(handle, msg, async, pair ? NULL : completion))
+    {
+        // TODO: unassignment failed. try again?
+        DEBUG_MSG("  unassignment timeout (id: %i)\n", assignment_key->id);
+    }
+    else
+    {
+        DEBUG_MSG("  unassignment %s (id: %i)\n", async ? "queued" : "done", assignment_key->id);
+    }
+
+    if (!async)
+        device->timeout = 0;
+
+    if (pair)
+    {
+        if (!async)
+            device->timeout = 0;
+
+        // request unassignment
+        cc_msg_t *msg_unassignment = cc_msg_builder(assignment_pair_key.device_id, CC_CMD_UNASSIGNMENT, &assignment_pair_key);
+        if (request_send(handle, msg_unassignment, async, completion))
+        {
+            // TODO: unassignment failed. try again?
+            DEBUG_MSG("  unassignment-2 timeout (id: %i)\n", assignment_pair_key.id);
+        }
+        else
+        {
+            DEBUG_MSG("  unassignment-2 %s (id: %i)\n", async ? "queued" : "done", assignment_pair_key.id);
+        }
+
+        if (!async)
+            device->timeout = 0;
+    }
+}
+
+static int value_set_request(cc_handle_t *handle, cc_set_value_t *update, bool async,
+    cc_completion_t *completion)
+{
+    completion_start(completion);
+
+    DEBUG_MSG("value_set received (id: %i, value: %f)\n", update->assignment_id, update->value);
+
+    const int id = update->assignment_id;
+
+    cc_device_t *device = cc_device_get(update->device_id);
+    cc_assignment_t *assignment = cc_assignment_get_by_actuator(update->device_id, update->actuator_id);
+
+    if (!device || !assignment)
+    {
+        completion_done(completion, 0);
+        return id;
+    }
+
+    assignment->value = update->value;
+
+    if (device_page(device) != assignment->actuator_page_id)
+    {
+        completion_done(completion, 0);
+        return id;
+    }
+
+    device->timeout = 0;
+
+    // request assignment
+    cc_msg_t *msg = cc_msg_builder(update->device_id, CC_CMD_SET_VALUE, update);
+    if (request_send(handle, msg, async, completion))
+    {
+        // TODO: if timeout, try at least one more time
+        DEBUG_MSG("  value_set timeout (id: %i)\n", id);
+
+        // remove assignment, not working anyhow
+        cc_assignment_key_t key = {update->device_id, id, -1};
+        cc_assignment_remove(&key);
+
+        return -1;
+    }
+    else
+    {
+        DEBUG_MSG("  value_set %s (id: %i)\n", async ? "queued" : "done", id);
+    }
+
+    if (!async)
+        device->timeout = 0;
+
+    return id;
+}
+
+static void device_disable_request(cc_handle_t *handle, int device_id, bool async,
+    cc_completion_t *completion)
+{
+    completion_start(completion);
+
+    int control = CC_DEVICE_DISABLE;
+
+    DEBUG_MSG("device disable received (device id: %i)\n", device_id);
+    DEBUG_MSG("  requesting device to disable (device id: %i)\n", device_id);
+
+    // request device disable
+    cc_msg_t *msg = cc_msg_builder(device_id, CC_CMD_DEV_CONTROL, &control);
+    if (request_send(handle, msg, async, completion))
+        DEBUG_MSG("  request timeout (device id: %i)\n", device_id);
+    else
+        DEBUG_MSG("  request %s (device id: %i)\n", async ? "queued" : "done", device_id);
+}
+
+#define UPDATE_DATA_SIZE (sizeof(float) + 1)
+
+static void parse_data_update(cc_handle_t *handle)
+{
+    const cc_msg_t *msg = handle->msg_rx;
+
+    // parse message to update list
+    cc_update_list_t *updates;
+    if (cc_msg_parser(msg, &updates) < 0)
+    {
+        DEBUG_MSG("invalid data update (device id: %i)\n", msg->device_id);
+        return;
+    }
+
+    DEBUG_MSG("updates received (device_id: %i, count: %i)\n", updates->device_id, updates->count);
+
+    for (int i = 0; i < updates->count; i++)
+    {
+        cc_assignment_key_t assignment_key = {
+            .id = updates->list[i].assignment_id,
+            .device_id = updates->device_id,
+            .pair_id = -1,
+        };
+
+        cc_device_t *device = cc_device_get(updates->device_id);
+        if (!device)
+        {
+            DEBUG_MSG("updates for device_id %i, device id is invalid\n", updates->device_id);
+            continue;
+        }
+
+        cc_assignment_t *assignment = cc_assignment_get(&assignment_key);
+        if (!assignment)
+        {
+            DEBUG_MSG("updates for device_id %i, assignment_id %i is invalid\n", updates->device_id, updates->list[i].assignment_id);
+            continue;
+        }
+
+        // change value
+        assignment->value = updates->list[i].value;
+
+        // also change value of paired assignment
+        cc_assignment_t *pair_assignment = NULL;
+
+        cc_assignment_key_t assignment_pair_key = {
+            .id = assignment->assignment_pair_id,
+            .device_id = assignment->device_id,
+            .pair_id = -1,
+        };
+
+        if (assignment_pair_key.id != -1)
+        {
+            pair_assignment = cc_assignment_get(&assignment_pair_key);
+
+            if (pair_assignment)
+                pair_assignment->value = assignment->value;
+        }
+
+        // we need to update list assignments
+        if ((assignment->mode & CC_MODE_OPTIONS) && assignment->enumeration_frame_max)
+        {
+            DEBUG_MSG("sending list update for assignment: %i %i\n", assignment->id, assignment->assignment_pair_id);
+
+            cc_assignment_update_list(assignment, assignment->value);
+
+            device->timeout = 0;
+
+            // the receiver must not wait for a requests cycle, the update goes out with the next one
+            // a message which could not be built is dropped by request_detached()
+            cc_msg_t *msg_enum = cc_msg_builder(updates->device_id, CC_CMD_UPDATE_ENUMERATION, assignment);
+            request_detached(handle, msg_enum, NULL);
+
+            if (pair_assignment)
+            {
+                cc_assignment_update_list(pair_assignment, pair_assignment->value);
+
+                cc_msg_t *msg_enum_r = cc_msg_builder(updates->device_id, CC_CMD_UPDATE_ENUMERATION, pair_assignment);
+                request_detached(handle, msg_enum_r, NULL);
+            }
+        }
+    }
+
+    if (updates->count > 0 && handle->data_update_cb && handle->dispatcher)
+    {
+        cc_dispatcher_data_update(handle->dispatcher, CC_DISPATCHER_RX, handle->data_update_cb, updates);
+        return;
+    }
+
+    if (updates->count > 0 && handle->data_update_cb)
+        handle->data_update_cb(updates);
+
+    cc_update_free(updates);
+}
+
+// the producer is the dispatcher ring of the calling context
+static void device_status(cc_handle_t *handle, int producer, cc_device_t *device)
+{
+    if (!handle->device_status_cb)
+        return;
+
+    if (handle->dispatcher)
+        cc_dispatcher_device_status(handle->dispatcher, producer, handle->device_status_cb, device);
+    else
+        handle->device_status_cb(device);
+}
+
+static void devices_timeout(cc_handle_t *handle)
+{
+    // device timeout checking
+    // only devices in "waiting for request" state (registered)
+    for (int id = 1; id <= CC_MAX_DEVICES; id++)
+    {
+        cc_device_t *device = cc_device_get(id);
+        if (device && device_registered(device))
+        {
+            device->timeout++;
+            // the timeout is counted in cycles of the regular sync interval
+            if ((int64_t) device->timeout * handle->sync_interval >= CC_DEVICE_TIMEOUT * CC_CHAIN_SYNC_INTERVAL)
+            {
+                DEBUG_MSG("device timeout (device id: %i)\n", device->id);
+
+                device->status = CC_DEVICE_DISCONNECTED;
+
+                // proceed to callback if any
+                device_status(handle, CC_DISPATCHER_SYNC, device);
+
+                cc_device_destroy(id);
+            }
+        }
+    }
+}
+
+// fetch the descriptors of the unregistered devices (threads engine only)
+// a few requests are kept outstanding so the replies come back to back
+// returns the number of devices requested
+static int descriptors_fetch(cc_handle_t *handle)
+{
+    cc_inflight_t *entries[CC_MAX_DEVICES];
+    int ids[CC_MAX_DEVICES];
+    int count = 0, sent = 0;
+
+    for (int id = 1; id <= CC_MAX_DEVICES; id++)
+    {
+        cc_device_t *device = cc_device_get(id);
+        if (device && !device_registered(device))
+            ids[count++] = id;
+    }
 
-            if (pair_assignment)
-                pair_assignment->value = assignment->value;
+    for (int i = 0; i < count; i++)
+    {
+        // top up the pipeline, the requests go out in a single write
+        while (sent < count && sent - i < CC_DESCRIPTORS_INFLIGHT)
+        {
+            entries[sent] = descriptor_request(handle, ids[sent]);
+            sent++;
         }
 
-        // we need to update list assignments
-        if ((assignment->mode & CC_MODE_OPTIONS) && assignment->enumeration_frame_max)
+        tx_flush(handle);
+
+        // not sent, the device is requested again on the next requests cycle
+        if (!entries[i])
+            continue;
+
+        if (inflight_wait(handle, entries[i]))
         {
-            DEBUG_MSG("sending list update for assignment: %i %i\n", assignment->id, assignment->assignment_pair_id);
+            DEBUG_MSG("device descriptor timeout (device id: %i)\n", ids[i]);
+            cc_device_destroy(ids[i]);
+        }
+    }
 
-            cc_assignment_update_list(assignment, assignment->value);
+    return count;
+}
 
-            device->timeout = 0;
+// keep up to CC_DESCRIPTORS_INFLIGHT descriptor requests outstanding (event loop only)
+// returns the number of outstanding requests, the sync cycle is held until it gets to 0
+static int descriptors_request(cc_handle_t *handle)
+{
+    for (int id = handle->descriptor_device_id + 1;
+         id <= CC_MAX_DEVICES && handle->descriptors_inflight < CC_DESCRIPTORS_INFLIGHT; id++)
+    {
+        handle->descriptor_device_id = id;
 
-            cc_msg_t *msg_enum = cc_msg_builder(updates->device_id, CC_CMD_UPDATE_ENUMERATION, assignment);
-            request(handle, msg_enum);
+        cc_device_t *device = cc_device_get(id);
+        if (device && !device_registered(device) && descriptor_request(handle, id))
+            handle->descriptors_inflight++;
+    }
 
-            device->timeout = 0;
-            cc_msg_delete(msg_enum);
+    tx_flush(handle);
 
-            if (pair_assignment)
-            {
-                cc_assignment_update_list(pair_assignment, pair_assignment->value);
+    // all devices requested and replied (or timed out)
+    if (handle->descriptors_inflight == 0)
+        handle->descriptor_device_id = 0;
 
-                device->timeout = 0;
+    return handle->descriptors_inflight;
+}
 
-                cc_msg_t *msg_enum_r = cc_msg_builder(updates->device_id, CC_CMD_UPDATE_ENUMERATION, pair_assignment);
-                request(handle, msg_enum_r);
+static void descriptor_received(cc_handle_t *handle, int device_id)
+{
+    // route the reply to its request, the threads engine has someone waiting for it
+    int64_t sent = inflight_reply(handle, device_id, CC_CMD_DEV_DESCRIPTOR);
 
-                device->timeout = 0;
-                cc_msg_delete(msg_enum_r);
-            }
-        }
+    // round trip time from the request until the reply started to arrive
+    if (sent)
+    {
+        pthread_mutex_lock(&handle->stats_lock);
+        cc_histogram_add(&handle->link_stats.rtt, handle->rx_frame_timestamp - sent);
+        pthread_mutex_unlock(&handle->stats_lock);
     }
 
-    if (updates->count > 0 && handle->data_update_cb)
-        handle->data_update_cb(updates);
+    if (handle->engine == CC_ENGINE_THREADS || !sent)
+        return;
 
-    cc_update_free(updates);
+    // request the next device, the held sync cycle ends after the last reply
+    handle->descriptors_inflight--;
+    if (!descriptors_request(handle))
+        send_sync(handle, CC_SYNC_REGULAR_CYCLE);
 }
 
 static void parser(cc_handle_t *handle)
@@ -421,6 +2327,10 @@ static void parser(cc_handle_t *handle)
 
     cc_msg_print("RECV", msg);
 
+    // chain is alive
+    handle->probe_deadline = 0;
+    handle->link_frames++;
+
     // reset device timeout
     for (int i = 0; i < CC_MAX_DEVICES; i++)
     {
@@ -435,7 +2345,11 @@ static void parser(cc_handle_t *handle)
         cc_handshake_mod_t response;
 
         // parse message to handshake data
-        cc_msg_parser(msg, &handshake);
+        if (cc_msg_parser(msg, &handshake) < 0)
+        {
+            DEBUG_MSG("invalid handshake\n");
+            return;
+        }
 
         int status = cc_handshake_check(&handshake, &response);
         if (status != CC_UPDATE_REQUIRED)
@@ -449,24 +2363,34 @@ static void parser(cc_handle_t *handle)
             }
         }
 
+        // a device joined, the link negotiation waits for the chain to settle
+        if (handle->link_state == CC_LINK_DEFAULT)
+            handle->link_cycle = handle->cycles_counter;
+
+        sync_wakeup(handle);
+
         DEBUG_MSG("handshake received\n");
         DEBUG_MSG("  random id: %i\n", handshake.random_id);
         DEBUG_MSG("  protocol: v%i.%i\n", handshake.protocol.major, handshake.protocol.minor);
         DEBUG_MSG("  firmware: v%i.%i.%i\n",
             handshake.protocol.major, handshake.protocol.minor, handshake.protocol.micro);
 
-        // create and send response message
-        cc_msg_t *reply = cc_msg_builder(0, CC_CMD_HANDSHAKE, &response);
-        send(handle, reply);
-        cc_msg_delete(reply);
+        // build the response straight into the transmit buffer
+        tx_append_build(handle, 0, CC_CMD_HANDSHAKE, &response);
+        tx_flush(handle);
     }
     else if (msg->command == CC_CMD_DEV_DESCRIPTOR)
     {
         cc_device_t *device = cc_device_get(msg->device_id);
         if (device)
         {
-            // parse message to device data
-            cc_msg_parser(msg, device);
+            // malformed descriptor, it's requested again on the next requests cycle
+            if (cc_msg_parser(msg, device) < 0)
+            {
+                DEBUG_MSG("invalid device descriptor (device id: %i)\n", device->id);
+                descriptor_received(handle, msg->device_id);
+                return;
+            }
 
             DEBUG_MSG("device descriptor received\n");
             DEBUG_MSG("  id: %i, uri: %s\n", device->id, device->uri->text);
@@ -494,17 +2418,16 @@ static void parser(cc_handle_t *handle)
             send(handle, &dev_desc_msg);
 
             // message received and parsed
-            sem_post(&handle->waiting_response);
+            descriptor_received(handle, msg->device_id);
 
             // proceed to callback if any
-            if (handle->device_status_cb)
-                handle->device_status_cb(device);
+            device_status(handle, CC_DISPATCHER_RX, device);
 
             device->timeout = 0;
         }
         else
         {
-            sem_post(&handle->waiting_response);
+            descriptor_received(handle, msg->device_id);
         }
     }
     else if (msg->command == CC_CMD_DATA_UPDATE)
@@ -513,8 +2436,12 @@ static void parser(cc_handle_t *handle)
     }
     else if (msg->command == CC_CMD_REQUEST_CONTROL_PAGE)
     {
-        DEBUG_MSG("  switching device %d control page to %d\n", msg->device_id, msg->data[0]);
-        cc_control_page(handle, msg->device_id, msg->data[0] - 1);
+        int page;
+        if (cc_msg_parser(msg, &page) == 0)
+        {
+            DEBUG_MSG("  switching device %d control page to %d\n", msg->device_id, page);
+            cc_control_page(handle, msg->device_id, page - 1);
+        }
     }
 
     // reset device timeout again
@@ -526,190 +2453,548 @@ static void parser(cc_handle_t *handle)
     }
 }
 
-static void* receiver(void *arg)
+// drop the frame being received
+static void receive_reset(cc_handle_t *handle)
+{
+    // with cobs framing an idle line means the next byte starts a new frame
+    handle->state = handle->rx_framing == CC_FRAMING_COBS ? WAITING_DATA : WAITING_SYNCING;
+    handle->rx_count = 0;
+    handle->rx_cobs_code = 0xFF;
+    handle->rx_cobs_left = 0;
+}
+
+static void receive_error(cc_handle_t *handle)
+{
+    handle->link_errors++;
+
+    pthread_mutex_lock(&handle->stats_lock);
+    handle->link_stats.crc_errors++;
+    pthread_mutex_unlock(&handle->stats_lock);
+}
+
+// check and parse a decoded cobs frame: header, data and crc
+static void receive_cobs_frame(cc_handle_t *handle)
 {
-    cc_handle_t *handle = (cc_handle_t *) arg;
     cc_msg_t *msg = handle->msg_rx;
+    const uint8_t *frame = msg->header;
+    int size = handle->rx_count;
+
+    if (size < CC_MSG_HEADER_SIZE + 1)
+    {
+        receive_error(handle);
+        return;
+    }
 
-    enum sp_return ret;
+    msg->device_id = frame[0];
+    msg->command = frame[1];
+    msg->data_size = frame[2] | (frame[3] << 8);
 
-    while (running(handle))
+    if (msg->device_id > CC_MAX_DEVICES ||
+        msg->command > CC_NUM_COMMANDS ||
+        msg->data_size != size - CC_MSG_HEADER_SIZE - 1 ||
+        crc8(frame, size - 1) != frame[size - 1])
     {
-        if (handle->serial_enabled == 0)
-            serial_setup(handle);
+        receive_error(handle);
+        return;
+    }
 
-        // waiting sync byte
-        if (handle->state == WAITING_SYNCING)
+    parser(handle);
+}
+
+// cobs framing, the zero delimiter always ends a frame so the receiver
+// gets back in sync on the first byte after line noise
+static void receive_cobs(cc_handle_t *handle, const uint8_t *buffer, int size)
+{
+    uint8_t *frame = handle->msg_rx->header;
+
+    for (const uint8_t *pbuf = buffer, *end = buffer + size; pbuf < end; pbuf++)
+    {
+        if (*pbuf == 0)
         {
-            uint8_t sync;
-            ret = sp_blocking_read(handle->sp, &sync, 1, CC_SYNC_TIMEOUT);
-            if (ret > 0)
+            if (handle->state == WAITING_DATA && handle->rx_count > 0)
             {
-                if (sync == CC_SYNC_BYTE)
-                    handle->state = WAITING_HEADER;
+                if (handle->rx_cobs_left == 0)
+                    receive_cobs_frame(handle);
+                else
+                    receive_error(handle);
             }
 
-            // take the shortcut
+            receive_reset(handle);
+            continue;
+        }
+
+        // discard everything until the next delimiter
+        if (handle->state != WAITING_DATA)
+            continue;
+
+        if (handle->rx_count >= CC_DATA_BUFFER_SIZE)
+        {
+            receive_error(handle);
+            handle->state = WAITING_SYNCING;
             continue;
         }
 
+        if (handle->rx_cobs_left == 0)
+        {
+            if (handle->rx_count == 0)
+                handle->rx_frame_timestamp = __atomic_load_n(&handle->rx_timestamp, __ATOMIC_RELAXED);
+
+            // blocks shorter than 254 bytes are followed by a zero, except the last one
+            if (handle->rx_cobs_code != 0xFF)
+                frame[handle->rx_count++] = 0;
+
+            handle->rx_cobs_code = *pbuf;
+            handle->rx_cobs_left = *pbuf - 1;
+        }
+        else
+        {
+            frame[handle->rx_count++] = *pbuf;
+            handle->rx_cobs_left--;
+        }
+    }
+}
+
+static void receive_raw(cc_handle_t *handle, const uint8_t *buffer, int size)
+{
+    cc_msg_t *msg = handle->msg_rx;
+    const uint8_t *pbuf = buffer, *end = buffer + size;
+
+    while (pbuf < end)
+    {
+        // waiting sync byte
+        if (handle->state == WAITING_SYNCING)
+        {
+            const uint8_t *sync = memchr(pbuf, CC_SYNC_BYTE, end - pbuf);
+            if (!sync)
+                break;
+
+            pbuf = sync + 1;
+            handle->rx_frame_timestamp = __atomic_load_n(&handle->rx_timestamp, __ATOMIC_RELAXED);
+            handle->rx_count = 0;
+            handle->rx_crc = 0;
+            handle->state = WAITING_HEADER;
+        }
+
         // waiting header
-        else if(handle->state == WAITING_HEADER)
+        else if (handle->state == WAITING_HEADER)
         {
-            ret = sp_blocking_read(handle->sp, msg->header, CC_MSG_HEADER_SIZE, CC_HEADER_TIMEOUT);
-            if (ret == CC_MSG_HEADER_SIZE)
+            msg->header[handle->rx_count++] = *pbuf;
+            handle->rx_crc = crc8_update(handle->rx_crc, pbuf, 1);
+            pbuf++;
+
+            if (handle->rx_count < CC_MSG_HEADER_SIZE)
+                continue;
+
+            msg->device_id = msg->header[0];
+            msg->command = msg->header[1];
+            msg->data_size = msg->header[2] | (msg->header[3] << 8);
+            handle->rx_count = 0;
+
+            if (msg->device_id > CC_MAX_DEVICES ||
+                msg->command > CC_NUM_COMMANDS ||
+                msg->data_size > CC_DATA_BUFFER_SIZE - CC_MSG_HEADER_SIZE)
             {
-                msg->device_id = msg->header[0];
-                msg->command = msg->header[1];
-                msg->data_size = *((uint16_t *) &msg->header[2]);
-
-                if (msg->device_id > CC_MAX_DEVICES ||
-                    msg->command > CC_NUM_COMMANDS ||
-                    msg->data_size > CC_DATA_BUFFER_SIZE - CC_MSG_HEADER_SIZE)
-                    handle->state = WAITING_SYNCING;
-                else if (msg->data_size == 0)
-                    handle->state = WAITING_CRC;
-                else
-                    handle->state = WAITING_DATA;
+                receive_error(handle);
+                handle->state = WAITING_SYNCING;
             }
+            else if (msg->data_size == 0)
+                handle->state = WAITING_CRC;
             else
             {
-                handle->state = WAITING_SYNCING;
+                // a long reply (e.g.: device descriptor) keeps its request alive until fully received
+                inflight_extend(handle, msg->device_id, msg->command, clock_us() +
+                    handle->response_timeout + 2 * airtime_us(handle, msg->data_size + 1));
+
+                handle->state = WAITING_DATA;
             }
         }
 
         // waiting data
         else if (handle->state == WAITING_DATA)
         {
-            ret = sp_blocking_read(handle->sp, msg->data, msg->data_size, CC_DATA_TIMEOUT);
-            if (ret == msg->data_size)
+            int len = msg->data_size - handle->rx_count;
+            if (len > end - pbuf)
+                len = end - pbuf;
+
+            memcpy(&msg->data[handle->rx_count], pbuf, len);
+            handle->rx_crc = crc8_update(handle->rx_crc, pbuf, len);
+            handle->rx_count += len;
+            pbuf += len;
+
+            if (handle->rx_count == msg->data_size)
                 handle->state = WAITING_CRC;
-            else
-                handle->state = WAITING_SYNCING;
         }
 
         // waiting crc
         else if (handle->state == WAITING_CRC)
         {
-            uint8_t crc;
-            ret = sp_blocking_read(handle->sp, &crc, 1, CC_DATA_TIMEOUT);
-            if (ret == 1)
-            {
-                if (crc8(msg->header, CC_MSG_HEADER_SIZE + msg->data_size) == crc)
-                {
-                    parser(handle);
-                }
-            }
+            if (*pbuf++ == handle->rx_crc)
+                parser(handle);
+            else
+                receive_error(handle);
 
             handle->state = WAITING_SYNCING;
         }
     }
+}
 
-    return NULL;
+static void receive(cc_handle_t *handle, const uint8_t *buffer, int size)
+{
+    __atomic_fetch_add(&handle->cycle_rx_bytes, size, __ATOMIC_RELAXED);
+
+    // framing changed by the link negotiation
+    if (handle->rx_framing != handle->framing)
+    {
+        handle->rx_framing = handle->framing;
+        receive_reset(handle);
+    }
+
+    if (handle->rx_framing == CC_FRAMING_COBS)
+        receive_cobs(handle, buffer, size);
+    else
+        receive_raw(handle, buffer, size);
 }
 
-static void* chain_sync(void *arg)
+static void* receiver(void *arg)
 {
     cc_handle_t *handle = (cc_handle_t *) arg;
 
-    unsigned int cycles_counter = 0;
+    while (running(handle))
+    {
+        if (handle->serial_enabled == 0)
+        {
+            serial_close(handle);
+
+            if (serial_setup(handle))
+            {
+                usleep(CC_SERIAL_WAIT_TIMEOUT * 1000);
+                continue;
+            }
+        }
 
-    uint8_t chain_sync_msg_data;
-    cc_msg_t chain_sync_msg = {
-        .device_id = 0,
-        .command = CC_CMD_CHAIN_SYNC,
-        .data_size = sizeof (chain_sync_msg_data),
-        .data = &chain_sync_msg_data
-    };
+        // read whatever is available, up to the buffer size
+        int ret = handle->transport.ops->read(&handle->transport, handle->rx_buffer, CC_RX_BUFFER_SIZE,
+            rx_timeout(handle));
 
-    uint8_t dev_desc_msg_data = CC_DEVICE_DESC_REQ;
-    cc_msg_t dev_desc_msg = {
-        .command = CC_CMD_DEV_DESCRIPTOR,
-        .data_size = sizeof (dev_desc_msg_data),
-        .data = &dev_desc_msg_data
-    };
+        if (ret > 0)
+        {
+            __atomic_store_n(&handle->rx_timestamp, clock_us(), __ATOMIC_RELAXED);
+            receive(handle, handle->rx_buffer, ret);
+        }
+
+        // usb-serial device was removed
+        else if (ret < 0 && errno == EIO)
+            handle->serial_enabled = 0;
+
+        // discard incomplete frame
+        else
+            receive_reset(handle);
+    }
+
+    return NULL;
+}
+
+static void* chain_sync(void *arg)
+{
+    cc_handle_t *handle = (cc_handle_t *) arg;
 
     // this is the setup sync cycle message
     // when a device receive this message it must reset to its initial state
     // such message can be seen as a software reset
-    chain_sync_msg.data[0] = CC_SYNC_SETUP_CYCLE;
-    send(handle, &chain_sync_msg);
+    send_sync(handle, CC_SYNC_SETUP_CYCLE);
+
+    handle->sync_deadline = clock_us() + handle->sync_interval;
 
     while (running(handle))
     {
-        // period between sync messages
-        usleep(CC_CHAIN_SYNC_INTERVAL);
+        // wait for the next cycle
+        sync_wait(handle);
 
-        // device timeout checking
-        // list only devices in "waiting for request" state
-        int *device_list = cc_device_list(CC_DEVICE_LIST_REGISTERED);
-        for (int i = 0; device_list[i]; i++)
+        if (!running(handle))
+            break;
+
+        sync_clock_update(handle);
+        airtime_update(handle);
+
+        devices_timeout(handle);
+
+        handle->cycles_counter++;
+
+        // nobody to talk to, look for new devices
+        if (sync_idle(handle))
         {
-            cc_device_t *device = cc_device_get(device_list[i]);
-            if (device)
-            {
-                device->timeout++;
-                if (device->timeout >= CC_DEVICE_TIMEOUT)
-                {
-                    DEBUG_MSG("device timeout (device id: %i)\n", device->id);
+            idle_cycle(handle);
+            continue;
+        }
+
+        timing_update(handle);
+
+        if (probing(handle) && (handle->cycles_counter % CC_HANDSHAKE_PERIOD) != 0)
+            continue;
+
+        // default sync message is regular cycle
+        uint8_t cycle = CC_SYNC_REGULAR_CYCLE;
+        cc_request_t *reqs[CC_REQUESTS_MAX];
+        int reqs_count = 0, requests = 0;
+
+        // handshake cycle
+        if ((handle->cycles_counter % CC_HANDSHAKE_PERIOD) == 0)
+        {
+            cycle = CC_SYNC_HANDSHAKE_CYCLE;
+        }
+        // requests cycle
+        else if (requests_cycle(handle))
+        {
+            // device descriptor requests, fetched before the sync message
+            // other requests (assignment, unassignment, ...) go with the sync message
+            requests = !descriptors_fetch(handle);
+        }
+
+        // each control chain frame starts with a sync message
+        // devices must only send 'data update' messages after receive a sync message
+        // the sync message and the requests after it, if any, go out in a single write
+        tx_append_sync(handle, cycle);
+
+        if (requests)
+            reqs_count = requests_append(handle, reqs);
+
+        tx_flush(handle);
+
+        requests_done(reqs, reqs_count);
+    }
+
+    return NULL;
+}
+
+// one sync cycle of the event loop, driven by the timer
+static void event_cycle(cc_handle_t *handle)
+{
+    // the sync cycle is held while device descriptors are being fetched
+    if (handle->descriptors_inflight)
+    {
+        int device_id, expired = 0;
+        while ((device_id = inflight_expire(handle, CC_CMD_DEV_DESCRIPTOR)))
+        {
+            DEBUG_MSG("device descriptor timeout (device id: %i)\n", device_id);
+            cc_device_destroy(device_id);
+
+            handle->descriptors_inflight--;
+            expired++;
+        }
 
-                    device->status = CC_DEVICE_DISCONNECTED;
+        if (expired && !descriptors_request(handle))
+            send_sync(handle, CC_SYNC_REGULAR_CYCLE);
 
-                    // proceed to callback if any
-                    if (handle->device_status_cb)
-                        handle->device_status_cb(device);
+        return;
+    }
+
+    devices_timeout(handle);
+
+    handle->cycles_counter++;
+
+    // nobody to talk to, look for new devices
+    if (sync_idle(handle))
+    {
+        idle_cycle(handle);
+        return;
+    }
+
+    timing_update(handle);
+
+    if (probing(handle) && (handle->cycles_counter % CC_HANDSHAKE_PERIOD) != 0)
+        return;
+
+    // handshake cycle
+    if ((handle->cycles_counter % CC_HANDSHAKE_PERIOD) == 0)
+    {
+        send_sync(handle, CC_SYNC_HANDSHAKE_CYCLE);
+        return;
+    }
+
+    cc_request_t *reqs[CC_REQUESTS_MAX];
+    int reqs_count = 0;
+
+    // requests cycle
+    const int requests = requests_cycle(handle);
+
+    // device descriptor requests, the sync message is sent when done
+    if (requests && descriptors_request(handle))
+        return;
+
+    // the sync message goes first, then other requests (assignment, unassignment, ...)
+    tx_append_sync(handle, CC_SYNC_REGULAR_CYCLE);
+
+    if (requests)
+        reqs_count = requests_append(handle, reqs);
+
+    tx_flush(handle);
+
+    requests_done(reqs, reqs_count);
+}
+
+static int event_serial_add(cc_handle_t *handle)
+{
+    handle->tx_watching = 0;
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = CC_EVENT_SERIAL};
+    return epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, handle->serial_fd, &event);
+}
+
+// the port watch wakes up the event loop when the serial port may have shown up
+static int event_port_watch(cc_handle_t *handle)
+{
+    handle->inotify_fd = serial_watch(handle);
+    if (handle->inotify_fd < 0)
+        return -1;
+
+    DEBUG_MSG("waiting for serial port %s\n", handle->port_name);
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u32 = CC_EVENT_PORT};
+    return epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, handle->inotify_fd, &event);
+}
+
+static void event_port_unwatch(cc_handle_t *handle)
+{
+    // closing it also removes it from the epoll set
+    if (handle->inotify_fd >= 0)
+        close(handle->inotify_fd);
+
+    handle->inotify_fd = -1;
+}
+
+// reopen the serial port without blocking the event loop, see serial_setup()
+// while the port isn't there, this is tried again on the port watch events and the timer ticks
+static void event_serial_open(cc_handle_t *handle)
+{
+    char port_path[CC_PORT_PATH_SIZE];
+    const char *address = handle->transport_address;
+
+    if (handle->transport.ops == &cc_transport_serial)
+    {
+        int ret = serial_check(handle, port_path, &handle->access_deadline);
+
+        // watch before checking again, so the port can't show up unnoticed in between
+        if (ret > 0 && handle->inotify_fd < 0 && event_port_watch(handle) == 0)
+            ret = serial_check(handle, port_path, &handle->access_deadline);
+
+        if (ret > 0)
+            return;
+
+        event_port_unwatch(handle);
+        handle->access_deadline = 0;
+
+        if (ret < 0)
+            return;
+
+        address = port_path;
+    }
+
+    if (serial_open(handle, address) == 0)
+        event_serial_add(handle);
+}
+
+static int event_loop_setup(cc_handle_t *handle)
+{
+    handle->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    handle->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    handle->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (handle->epoll_fd < 0 || handle->timer_fd < 0 || handle->event_fd < 0)
+        return -1;
+
+    // sync cadence, the timer expires on absolute deadlines
+    handle->sync_deadline = clock_us() + handle->sync_interval;
+    if (sync_timer_set(handle))
+        return -1;
+
+    struct epoll_event event = {.events = EPOLLIN};
+
+    event.data.u32 = CC_EVENT_TIMER;
+    if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, handle->timer_fd, &event))
+        return -1;
+
+    event.data.u32 = CC_EVENT_REQUEST;
+    if (epoll_ctl(handle->epoll_fd, EPOLL_CTL_ADD, handle->event_fd, &event))
+        return -1;
 
-                    cc_device_destroy(device_list[i]);
-                }
-            }
-        }
-        free(device_list);
+    return event_serial_add(handle);
+}
 
-        cycles_counter++;
+static void* event_loop(void *arg)
+{
+    cc_handle_t *handle = (cc_handle_t *) arg;
+    struct epoll_event events[CC_EVENTS_MAX];
 
-        // default sync message is regular cycle
-        chain_sync_msg.data[0] = CC_SYNC_REGULAR_CYCLE;
+    // setup sync cycle, see chain_sync()
+    send_sync(handle, CC_SYNC_SETUP_CYCLE);
 
-        // handshake cycle
-        if ((cycles_counter % CC_HANDSHAKE_PERIOD) == 0)
+    while (running(handle))
+    {
+        // closing the serial port also removes it from the epoll set
+        if (handle->serial_enabled == 0)
         {
-            chain_sync_msg.data[0] = CC_SYNC_HANDSHAKE_CYCLE;
+            serial_close(handle);
+            event_serial_open(handle);
         }
-        // requests cycle
-        else if ((cycles_counter % CC_REQUESTS_PERIOD) == 0)
+
+        int count = epoll_wait(handle->epoll_fd, events, CC_EVENTS_MAX, -1);
+
+        for (int i = 0; i < count; i++)
         {
-            // device descriptor request
-            int *device_list = cc_device_list(CC_DEVICE_LIST_UNREGISTERED);
-            if (*device_list)
+            uint64_t value;
+
+            if (events[i].data.u32 == CC_EVENT_SERIAL)
             {
-                for (int i = 0; device_list[i]; i++)
+                int ret = 0;
+                while (handle->serial_enabled &&
+                      (ret = handle->transport.ops->read(&handle->transport, handle->rx_buffer, CC_RX_BUFFER_SIZE, 0)) > 0)
                 {
-                    dev_desc_msg.device_id = device_list[i];
+                    __atomic_store_n(&handle->rx_timestamp, clock_us(), __ATOMIC_RELAXED);
+                    receive(handle, handle->rx_buffer, ret);
+                }
 
-                    pthread_mutex_lock(&handle->request_lock);
+                // resume pending writes
+                if (handle->serial_enabled && (events[i].events & EPOLLOUT))
+                    tx_flush(handle);
 
-                    // request device descriptor
-                    if (send_and_wait(handle, &dev_desc_msg))
-                        cc_device_destroy(device_list[i]);
+                // usb-serial device was removed
+                if (ret < 0 || (events[i].events & (EPOLLERR | EPOLLHUP)))
+                    handle->serial_enabled = 0;
+            }
+            else if (events[i].data.u32 == CC_EVENT_TIMER)
+            {
+                if (read(handle->timer_fd, &value, sizeof(value)) < 0)
+                    continue;
 
-                    pthread_mutex_unlock(&handle->request_lock);
-                }
+                sync_clock_update(handle);
+                airtime_update(handle);
+
+                // discard incomplete frame
+                if (clock_us() - __atomic_load_n(&handle->rx_timestamp, __ATOMIC_RELAXED) > rx_timeout(handle) * 1000)
+                    receive_reset(handle);
+
+                event_cycle(handle);
             }
-            // other requests (assignment, unassignment, ...)
-            else
+            else if (events[i].data.u32 == CC_EVENT_PORT)
             {
-                pthread_mutex_lock(&handle->request_lock);
-                atomic_store(&handle->request_sync, true);
-                pthread_cond_signal(&handle->request_cond);
-                pthread_mutex_unlock(&handle->request_lock);
+                // the events content doesn't matter, the port is checked again anyway
+                uint8_t port_events[1024];
+                while (read(handle->inotify_fd, port_events, sizeof(port_events)) > 0);
             }
+            else if (events[i].data.u32 == CC_EVENT_REQUEST)
+            {
+                // requests are sent on the next requests cycle
+                if (read(handle->event_fd, &value, sizeof(value)) < 0)
+                    continue;
 
-            free(device_list);
+                // which an idle chain runs right away
+                if (handle->idle)
+                {
+                    handle->sync_deadline = clock_us();
+                    sync_timer_set(handle);
+                }
+            }
         }
-
-        // each control chain frame starts with a sync message
-        // devices must only send 'data update' messages after receive a sync message
-        send(handle, &chain_sync_msg);
     }
 
     return NULL;
@@ -723,6 +3008,11 @@ static void* chain_sync(void *arg)
 */
 
 cc_handle_t* cc_init(const char *port_name, int baudrate)
+{
+    return cc_init_options(port_name, baudrate, NULL);
+}
+
+cc_handle_t* cc_init_options(const char *port_name, int baudrate, const cc_options_t *options)
 {
     cc_handle_t *handle = (cc_handle_t *) malloc(sizeof (cc_handle_t));
 
@@ -735,33 +3025,71 @@ cc_handle_t* cc_init(const char *port_name, int baudrate)
 
     // init handle with null data
     memset(handle, 0, sizeof (cc_handle_t));
+    handle->epoll_fd = handle->timer_fd = handle->event_fd = handle->inotify_fd = -1;
+    handle->transport.fd = handle->transport.peer_fd = -1;
+    handle->engine = options ? options->engine : CC_ENGINE_THREADS;
+    handle->low_latency = options ? options->low_latency : 0;
+    handle->link_baudrate = options ? options->link_baudrate : 0;
+    handle->link_framing = options ? options->link_framing : CC_FRAMING_RAW;
+    handle->latency_timer_default = -1;
+    handle->link_stats.latency_timer = -1;
+    handle->sync_interval = CC_CHAIN_SYNC_INTERVAL;
+    handle->mode_timestamp = clock_us();
+    handle->auto_timing = options ? options->auto_timing : 0;
+    handle->response_timeout = CC_RESPONSE_TIMEOUT * 1000;
 
     // create a message object for receiving data
     handle->msg_rx = cc_msg_new();
 
-    // serial setup
-    handle->baudrate = baudrate;
-    handle->port_name = port_name;
-    if (serial_setup(handle))
-    {
-        cc_finish(handle);
-        return NULL;
-    }
+    // sync messages never change, build them only once
+    sync_frames_setup(handle);
 
     // create mutexes
     pthread_mutex_init(&handle->sending, NULL);
     pthread_mutex_init(&handle->running, NULL);
     pthread_mutex_init(&handle->request_lock, NULL);
-    pthread_cond_init(&handle->request_cond, NULL);
+    pthread_mutex_init(&handle->stats_lock, NULL);
+    pthread_mutex_init(&handle->inflight_lock, NULL);
+    pthread_mutex_init(&handle->idle_lock, NULL);
 
-    atomic_init(&handle->request_sync, false);
+    // idle waits use the same clock as the sync deadlines
+    pthread_condattr_t condattr;
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&handle->idle_cond, &condattr);
+    pthread_condattr_destroy(&condattr);
 
     pthread_mutex_lock(&handle->running);
 
+    // serial setup
+    handle->baudrate = baudrate;
+    handle->port_name = port_name;
+    handle->transport.ops = cc_transport_select(port_name, &handle->transport_address);
+    if (options && options->transport)
+    {
+        handle->transport.ops = options->transport;
+        handle->transport_address = port_name;
+    }
+    if (serial_setup(handle))
+    {
+        cc_finish(handle);
+        return NULL;
+    }
+
     // semaphores
-    sem_init(&handle->waiting_response, 0, 0);
+    for (int i = 0; i < CC_INFLIGHT_MAX; i++)
+        sem_init(&handle->inflight[i].reply, 0, 0);
 
-    //////// receiver thread setup
+    // callbacks dispatcher
+    if (options && options->dispatcher)
+    {
+        handle->dispatcher = cc_dispatcher_new();
+        if (!handle->dispatcher)
+        {
+            cc_finish(handle);
+            return NULL;
+        }
+    }
 
     // set thread attributes
     pthread_attr_t attributes;
@@ -769,11 +3097,42 @@ cc_handle_t* cc_init(const char *port_name, int baudrate)
     pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
     pthread_attr_setscope(&attributes, PTHREAD_SCOPE_PROCESS);
 
+    int ret_val;
+
+    //////// event loop setup
+
+    if (handle->engine == CC_ENGINE_EVENT_LOOP)
+    {
+        if (event_loop_setup(handle))
+        {
+            pthread_attr_destroy(&attributes);
+            cc_finish(handle);
+            return NULL;
+        }
+
+        // create thread
+        ret_val = pthread_create(&handle->event_loop_thread, &attributes, event_loop, (void*) handle);
+        pthread_attr_destroy(&attributes);
+
+        if (ret_val != 0)
+        {
+            cc_finish(handle);
+            return NULL;
+        }
+
+        DEBUG_MSG("control chain started (port: %s, baud rate: %i, event loop)\n", port_name, baudrate);
+
+        return handle;
+    }
+
+    //////// receiver thread setup
+
     // create thread
-    int ret_val = pthread_create(&handle->receiver_thread, &attributes, receiver, (void*) handle);
+    ret_val = pthread_create(&handle->receiver_thread, &attributes, receiver, (void*) handle);
 
     if (ret_val != 0)
     {
+        pthread_attr_destroy(&attributes);
         cc_finish(handle);
         return NULL;
     }
@@ -810,235 +3169,219 @@ void cc_finish(cc_handle_t *handle)
 
         pthread_mutex_unlock(&handle->running);
 
+        // wake up the chain sync thread if it's idle
+        pthread_mutex_lock(&handle->idle_lock);
+        pthread_cond_signal(&handle->idle_cond);
+        pthread_mutex_unlock(&handle->idle_lock);
+
         if (handle->receiver_thread)
             pthread_join(handle->receiver_thread, NULL);
 
         if (handle->chain_sync_thread)
             pthread_join(handle->chain_sync_thread, NULL);
 
-        if (handle->sp)
+        if (handle->event_loop_thread)
         {
-            sp_close(handle->sp);
-            sp_free_port(handle->sp);
-        }
-
-        cc_msg_delete(handle->msg_rx);
-        free(handle);
-
-        DEBUG_MSG("control chain finished\n");
-    }
-}
+            // wake up event loop so it can notice it must stop
+            // if the wake up fails the loop still notices it on its next timer tick
+            uint64_t value = 1;
+            if (write(handle->event_fd, &value, sizeof(value)) < 0)
+                DEBUG_MSG("failed to notify event loop\n");
 
-int cc_assignment(cc_handle_t *handle, cc_assignment_t *assignment, bool new_assignment)
-{
-    cc_device_t *device = cc_device_get(assignment->device_id);
+            pthread_join(handle->event_loop_thread, NULL);
+        }
 
-    if (!device)
-        return -1;
+        // run the callbacks still queued
+        cc_dispatcher_delete(handle->dispatcher);
 
-    if (new_assignment)
-    {
-        // check if we need to save enumeration stuff
-        if ((assignment->mode & CC_MODE_OPTIONS) && device->enumeration_frame_item_count)
-            cc_assignment_update_list(assignment, assignment->value);
+        // release requests which didn't get a requests cycle
+        cc_request_t *req;
+        while ((req = request_pop(handle, INT_MAX)))
+            request_done(req, 1);
 
-        // set page id
-        assignment->actuator_page_id = assignment->actuator_id / (device->actuators_count + device->actuatorgroups_count);
+        if (handle->epoll_fd >= 0)
+            close(handle->epoll_fd);
 
-        // add assignment
-        assignment->id = cc_assignment_add(assignment);
-    }
+        if (handle->timer_fd >= 0)
+            close(handle->timer_fd);
 
-    if (assignment->id < 0)
-        return -1;
+        if (handle->event_fd >= 0)
+            close(handle->event_fd);
 
-    // enforce initial value for momentary-mode assignments
-    if (assignment->mode & CC_MODE_MOMENTARY)
-        assignment->value = assignment->mode & CC_MODE_REVERSE ? assignment->max : assignment->min;
+        if (handle->inotify_fd >= 0)
+            close(handle->inotify_fd);
 
-    // we only send the actuators of the current page
-    if (device->current_page == assignment->actuator_page_id)
-    {
-        device->timeout = 0;
+        serial_close(handle);
 
-        cc_msg_t *msg = cc_msg_builder(assignment->device_id, CC_CMD_ASSIGNMENT, assignment);
-        if (request(handle, msg))
-        {
-            // TODO: if timeout, try at least one more time
-            DEBUG_MSG("  assignment timeout (id: %i)\n", assignment->id);
-        }
-        else
-        {
-            DEBUG_MSG("  assignment done (id: %i)\n", assignment->id);
-        }
+        cc_msg_delete(handle->msg_rx);
+        free(handle);
 
-        device->timeout = 0;
-        cc_msg_delete(msg);
+        DEBUG_MSG("control chain finished\n");
     }
+}
 
-    return assignment->id;
+int cc_assignment(cc_handle_t *handle, cc_assignment_t *assignment, bool new_assignment)
+{
+    return assignment_request(handle, assignment, new_assignment, false, NULL);
+}
+
+int cc_assignment_async(cc_handle_t *handle, cc_assignment_t *assignment, bool new_assignment,
+    cc_completion_t *completion)
+{
+    return assignment_request(handle, assignment, new_assignment, true, completion);
 }
 
 void cc_unassignment(cc_handle_t *handle, cc_assignment_key_t *assignment_key)
 {
-    cc_device_t *device = cc_device_get(assignment_key->device_id);
-    cc_assignment_t *assignment = cc_assignment_get(assignment_key);
+    unassignment_request(handle, assignment_key, false, NULL);
+}
 
-    const cc_assignment_key_t assignment_pair_key = {
-        assignment_key->pair_id, assignment_key->device_id, -1
-    };
+void cc_unassignment_async(cc_handle_t *handle, cc_assignment_key_t *assignment_key,
+    cc_completion_t *completion)
+{
+    unassignment_request(handle, assignment_key, true, completion);
+}
 
-    const bool assignment_active = device && assignment && device->current_page == assignment->actuator_page_id;
+int cc_value_set(cc_handle_t *handle, cc_set_value_t *update)
+{
+    return value_set_request(handle, update, false, NULL);
+}
 
-    int ret = cc_assignment_remove(assignment_key);
+int cc_value_set_async(cc_handle_t *handle, cc_set_value_t *update, cc_completion_t *completion)
+{
+    return value_set_request(handle, update, true, completion);
+}
 
-    DEBUG_MSG("unassignment received (id: %i, ret: %i)\n", assignment_key->id, ret);
+void cc_control_page(cc_handle_t *handle, int device_id, int page)
+{
+    cc_device_t *device = cc_device_get(device_id);
 
-    if (ret < 0)
+    if (!device)
         return;
 
-    if (assignment_pair_key.id != -1)
-    {
-        ret = cc_assignment_remove(&assignment_pair_key);
-
-        DEBUG_MSG("group unassignment received (id: %i, ret: %i)\n", assignment_pair_key.id, ret);
-
-        if (ret < 0)
-            return;
-    }
+    // the pages are part of the descriptor, which may be replaced meanwhile
+    cc_device_lock();
 
-    if (!assignment_active)
+    if (page < 0 || page > device->amount_of_pages)
+    {
+        cc_device_unlock();
         return;
+    }
 
-    DEBUG_MSG("  requesting unassignment to device (id: %i)\n", assignment_key->id);
+    device->current_page = page;
 
-    device->timeout = 0;
+    const int actuators_count = device->actuators_count;
+    const int actuators_page_offset = page * (actuators_count + device->actuatorgroups_count);
 
-    // request unassignment
-    cc_msg_t *msg = cc_msg_builder(assignment_key->device_id, CC_CMD_UNASSIGNMENT, assignment_key);
-    if (request(handle, msg))
-    {
-        // TODO: unassignment failed. try again?
-        DEBUG_MSG("  unassignment timeout (id: %i)\n", assignment_key->id);
-    }
-    else
-    {
-        DEBUG_MSG("  unassignment done (id: %i)\n", assignment_key->id);
-    }
+    cc_device_unlock();
 
     device->timeout = 0;
-    cc_msg_delete(msg);
 
-    if (assignment_pair_key.id != -1)
+    for (int i = 0; i < actuators_count; i++)
     {
-        device->timeout = 0;
-
-        // request unassignment
-        cc_msg_t *msg_unassignment = cc_msg_builder(assignment_pair_key.device_id, CC_CMD_UNASSIGNMENT, &assignment_pair_key);
-        if (request(handle, msg_unassignment))
-        {
-            // TODO: unassignment failed. try again?
-            DEBUG_MSG("  unassignment-2 timeout (id: %i)\n", assignment_pair_key.id);
-        }
-        else
-        {
-            DEBUG_MSG("  unassignment-2 done (id: %i)\n", assignment_pair_key.id);
-        }
+        cc_assignment_t *assignment = cc_assignment_get_by_actuator(device_id, actuators_page_offset + i);
 
-        device->timeout = 0;
-        cc_msg_delete(msg_unassignment);
+        if (assignment)
+            cc_assignment(handle, assignment, false);
     }
+
+    device->timeout = 0;
 }
 
-int cc_value_set(cc_handle_t *handle, cc_set_value_t *update)
+void cc_device_disable(cc_handle_t *handle, int device_id)
 {
-    DEBUG_MSG("value_set received (id: %i, value: %f)\n", update->assignment_id, update->value);
-
-    const int id = update->assignment_id;
-
-    cc_device_t *device = cc_device_get(update->device_id);
-    cc_assignment_t *assignment = cc_assignment_get_by_actuator(update->device_id, update->actuator_id);
-
-    if (!device || !assignment)
-        return id;
+    device_disable_request(handle, device_id, false, NULL);
+}
 
-    assignment->value = update->value;
+void cc_device_disable_async(cc_handle_t *handle, int device_id, cc_completion_t *completion)
+{
+    device_disable_request(handle, device_id, true, completion);
+}
 
-    if (device->current_page != assignment->actuator_page_id)
-        return id;
+void cc_data_update_cb(cc_handle_t *handle, void (*callback)(void *arg))
+{
+    handle->data_update_cb = callback;
+}
 
-    device->timeout = 0;
+void cc_device_status_cb(cc_handle_t *handle, void (*callback)(void *arg))
+{
+    handle->device_status_cb = callback;
+}
 
-    // request assignment
-    cc_msg_t *msg = cc_msg_builder(update->device_id, CC_CMD_SET_VALUE, update);
-    if (request(handle, msg))
-    {
-        // TODO: if timeout, try at least one more time
-        DEBUG_MSG("  value_set timeout (id: %i)\n", id);
+void cc_sync_stats(cc_handle_t *handle, cc_sync_stats_t *stats, bool reset)
+{
+    pthread_mutex_lock(&handle->stats_lock);
 
-        // remove assignment, not working anyhow
-        cc_assignment_key_t key = {update->device_id, id, -1};
-        cc_assignment_remove(&key);
+    *stats = handle->sync_stats;
 
-        return -1;
-    }
+    // the current mode counts until now
+    int64_t now = clock_us();
+    stats->idle = handle->idle;
+    if (handle->idle)
+        stats->idle_time += now - handle->mode_timestamp;
     else
+        stats->active_time += now - handle->mode_timestamp;
+
+    if (reset)
     {
-        DEBUG_MSG("  value_set done (id: %i)\n", id);
+        memset(&handle->sync_stats, 0, sizeof(cc_sync_stats_t));
+        handle->mode_timestamp = now;
     }
 
-    device->timeout = 0;
-    cc_msg_delete(msg);
-
-    return id;
+    pthread_mutex_unlock(&handle->stats_lock);
 }
 
-void cc_control_page(cc_handle_t *handle, int device_id, int page)
+void cc_tx_stats(cc_handle_t *handle, cc_tx_stats_t *stats)
 {
-    cc_device_t *device = cc_device_get(device_id);
-
-    if (!device || page < 0 || page > device->amount_of_pages)
-        return;
+    pthread_mutex_lock(&handle->sending);
 
-    device->current_page = page;
-    device->timeout = 0;
+    *stats = handle->tx_stats;
+    stats->backlog = handle->tx_backlog_size;
+    stats->in_flight = handle->tx_backlog_size;
 
-    const int actuators_page_offset = page * (device->actuators_count + device->actuatorgroups_count);
-
-    for (int i = 0; i < device->actuators_count; i++)
+    if (handle->serial_enabled)
     {
-        cc_assignment_t *assignment = cc_assignment_get_by_actuator(device_id, actuators_page_offset + i);
-
-        if (assignment)
-            cc_assignment(handle, assignment, false);
+        // bytes still in the driver output buffer
+        int waiting;
+        if (ioctl(handle->serial_fd, TIOCOUTQ, &waiting) == 0 && waiting > 0)
+            stats->in_flight += waiting;
     }
 
-    device->timeout = 0;
+    pthread_mutex_unlock(&handle->sending);
+
+    pthread_mutex_lock(&handle->request_lock);
+    stats->queue_depth = handle->requests_count;
+    pthread_mutex_unlock(&handle->request_lock);
 }
 
-void cc_device_disable(cc_handle_t *handle, int device_id)
+void cc_link_stats(cc_handle_t *handle, cc_link_stats_t *stats)
 {
-    int control = CC_DEVICE_DISABLE;
-
-    DEBUG_MSG("device disable received (device id: %i)\n", device_id);
-    DEBUG_MSG("  requesting device to disable (device id: %i)\n", device_id);
+    pthread_mutex_lock(&handle->stats_lock);
+    *stats = handle->link_stats;
+    pthread_mutex_unlock(&handle->stats_lock);
+}
 
-    // request device disable
-    cc_msg_t *msg = cc_msg_builder(device_id, CC_CMD_DEV_CONTROL, &control);
-    if (request(handle, msg))
-        DEBUG_MSG("  request timeout (device id: %i)\n", device_id);
+void cc_dispatch_stats(cc_handle_t *handle, cc_dispatch_stats_t *stats)
+{
+    if (handle->dispatcher)
+        cc_dispatcher_stats(handle->dispatcher, stats);
     else
-        DEBUG_MSG("  request done (device id: %i)\n", device_id);
+        memset(stats, 0, sizeof(cc_dispatch_stats_t));
+}
 
-    cc_msg_delete(msg);
+void cc_bus_stats(cc_handle_t *handle, cc_bus_stats_t *stats)
+{
+    pthread_mutex_lock(&handle->stats_lock);
+    *stats = handle->bus_stats;
+    pthread_mutex_unlock(&handle->stats_lock);
 }
 
-void cc_data_update_cb(cc_handle_t *handle, void (*callback)(void *arg))
+int cc_transport_peer(cc_handle_t *handle)
 {
-    handle->data_update_cb = callback;
+    return handle->transport.peer_fd;
 }
 
-void cc_device_status_cb(cc_handle_t *handle, void (*callback)(void *arg))
+int cc_completion_done(const cc_completion_t *completion)
 {
-    handle->device_status_cb = callback;
+    return __atomic_load_n(&completion->done, __ATOMIC_ACQUIRE);
 }
@@ -26,6 +26,8 @@
 ****************************************************************************************************
 */
 
+#include <stdint.h>
+#include "transport.h"
 
 /*
 ****************************************************************************************************
@@ -49,6 +51,42 @@
 
 typedef struct cc_handle_t cc_handle_t;
 
+// chain engines
+// THREADS uses a receiver thread and a chain sync thread
+// EVENT_LOOP runs the serial, the sync cadence and the requests from a single epoll loop
+enum {CC_ENGINE_THREADS, CC_ENGINE_EVENT_LOOP};
+
+// low_latency: configure the serial port and usb-serial adapter for the lowest latency
+// link_baudrate: baud rate negotiated once all devices support it, 0 to disable
+// link_framing: framing negotiated once all devices support it (CC_FRAMING_*)
+// transport: overrides the transport selected from the port name scheme
+// dispatcher: run the data update and device status callbacks from a dedicated thread
+// auto_timing: size the sync interval and the timeouts from the bus airtime and the devices count
+typedef struct cc_options_t {
+    int engine;
+    int low_latency;
+    int link_baudrate;
+    int link_framing;
+    const cc_transport_ops_t *transport;
+    int dispatcher;
+    int auto_timing;
+} cc_options_t;
+
+// completion of an asynchronous request, owned by the caller and valid until completed
+// ret: 0 on success, non zero if the request was dropped (e.g.: chain finished)
+// queued, sent, completed: monotonic timestamps in us
+// callback: optional, called once from the thread which completed the request: a library thread,
+// or the caller if nothing had to be sent or a newer value update superseded the request
+// it must not block nor call the blocking API
+// done: set after all the other fields, see cc_completion_done()
+typedef struct cc_completion_t {
+    int ret;
+    int64_t queued, sent, completed;
+    void (*callback)(struct cc_completion_t *completion);
+    void *arg;
+    int done;
+} cc_completion_t;
+
 
 /*
 ****************************************************************************************************
@@ -57,8 +95,16 @@ typedef struct cc_handle_t cc_handle_t;
 */
 
 cc_handle_t* cc_init(const char *port_name, int baudrate);
+cc_handle_t* cc_init_options(const char *port_name, int baudrate, const cc_options_t *options);
 void cc_finish(cc_handle_t *handle);
 
+// return the device side of the loopback transport, -1 for other transports
+// the file descriptor is owned by the library and valid until cc_finish()
+int cc_transport_peer(cc_handle_t *handle);
+
+// return 1 once the asynchronous request of the completion was completed
+int cc_completion_done(const cc_completion_t *completion);
+
 
 /*
 ****************************************************************************************************
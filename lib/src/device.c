@@ -25,6 +25,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <jansson.h>
 #include "device.h"
 
@@ -35,6 +36,8 @@
 ****************************************************************************************************
 */
 
+#define CC_NAME_BUFFER_SIZE     (255 + 16)  // longest name plus the page number
+
 // device status
 enum {DEV_WAITING_HANDSHAKE, DEV_WAITING_DESCRIPTOR, DEV_WAITING_ASSIGNMENT};
 
@@ -60,6 +63,7 @@ enum {DEV_WAITING_HANDSHAKE, DEV_WAITING_DESCRIPTOR, DEV_WAITING_ASSIGNMENT};
 */
 
 static cc_device_t g_devices[CC_MAX_DEVICES];
+static pthread_mutex_t g_devices_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 /*
@@ -112,40 +116,24 @@ void cc_device_destroy(int device_id)
     if (!device)
         return;
 
-    // destroy URI and label
-    string_destroy(device->uri);
-    string_destroy(device->label);
+    // destroy URI, label, actuators and actuator groups
+    // until the descriptor is received the URI, if any, comes from the handshake
+    cc_device_lock();
+
+    void *descriptor = device->descriptor;
+    string_t *uri = device->uri;
+
+    device->descriptor = NULL;
     device->uri = device->label = NULL;
+    device->actuators = NULL;
+    device->actuatorgroups = NULL;
 
-    // destroy actuators
-    if (device->actuators)
-    {
-        for (int i = 0; i < device->actuators_count * device->amount_of_pages; i++)
-        {
-            if (device->actuators[i])
-            {
-                string_destroy(device->actuators[i]->name);
-                free(device->actuators[i]);
-            }
-        }
-        free(device->actuators);
-        device->actuators = NULL;
-    }
+    cc_device_unlock();
 
-    // destroy actuator groups
-    if (device->actuatorgroups)
-    {
-        for (int i = 0; i < device->actuatorgroups_count * device->amount_of_pages; i++)
-        {
-            if (device->actuatorgroups[i])
-            {
-                string_destroy(device->actuatorgroups[i]->name);
-                free(device->actuatorgroups[i]);
-            }
-        }
-        free(device->actuatorgroups);
-        device->actuatorgroups = NULL;
-    }
+    if (descriptor)
+        free(descriptor);
+    else
+        string_destroy(uri);
 
     // destroy assigments list
     if (device->assignments)
@@ -171,6 +159,15 @@ char* cc_device_descriptor(int device_id)
     if (!device)
         return NULL;
 
+    cc_device_lock();
+
+    // the device may have left meanwhile or not be registered yet
+    if (!device->label || !device->uri)
+    {
+        cc_device_unlock();
+        return NULL;
+    }
+
     json_t *root = json_object();
 
     // label
@@ -203,127 +200,77 @@ char* cc_device_descriptor(int device_id)
         json_object_set_new(root, "chain_id", chain_id);
     }
 
-    // actuators
+    // actuators and actuator groups, the entries of each page are created from the first page ones
     json_t *json_actuators = json_array();
     json_object_set_new(root, "actuators", json_actuators);
 
-    // populate actuators list
-    for (int i = 0; i < device->actuators_count; i++)
-    {
-        cc_actuator_t *actuator = device->actuators[i];
-        json_t *json_actuator = json_object();
+    json_t *json_actuatorgroups = json_array();
+    json_object_set_new(root, "actuatorgroups", json_actuatorgroups);
 
-        // actuator id
-        json_t *id = json_integer(actuator->id);
-        json_object_set_new(json_actuator, "id", id);
+    const int actuators_per_page = device->actuators_count + device->actuatorgroups_count;
+    char name_buffer[CC_NAME_BUFFER_SIZE];
 
-        // actuator name
-        json_t *name = json_stringn(actuator->name->text, actuator->name->size);
-        json_object_set_new(json_actuator, "name", name);
+    for (int page = 0; page < device->amount_of_pages; page++)
+    {
+        const int page_offset = page * actuators_per_page;
 
-        // actuator supported modes
-        json_t *supported_modes = json_integer(actuator->supported_modes);
-        json_object_set_new(json_actuator, "supported_modes", supported_modes);
+        // populate actuators list
+        for (int i = 0; i < device->actuators_count; i++)
+        {
+            cc_actuator_t *actuator = device->actuators[i];
+            json_t *json_actuator = json_object();
 
-        // actuator maximum assignments
-        json_t *max_assignments = json_integer(actuator->max_assignments);
-        json_object_set_new(json_actuator, "max_assignments", max_assignments);
+            // actuator id
+            json_t *id = json_integer(actuator->id + page_offset);
+            json_object_set_new(json_actuator, "id", id);
 
-        // add to list
-        json_array_append_new(json_actuators, json_actuator);
-    }
+            // actuator name
+            int size = cc_device_page_name(device, actuator->name, page, name_buffer, sizeof(name_buffer));
+            json_t *name = json_stringn(name_buffer, size);
+            json_object_set_new(json_actuator, "name", name);
 
-    // actuator groups
-    json_t *json_actuatorgroups = json_array();
-    json_object_set_new(root, "actuatorgroups", json_actuatorgroups);
+            // actuator supported modes
+            json_t *supported_modes = json_integer(actuator->supported_modes);
+            json_object_set_new(json_actuator, "supported_modes", supported_modes);
 
-    // populate actuator groups list
-    for (int i = 0; i < device->actuatorgroups_count; i++)
-    {
-        cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[i];
-        json_t *json_actuatorgroup = json_object();
+            // actuator maximum assignments
+            json_t *max_assignments = json_integer(actuator->max_assignments);
+            json_object_set_new(json_actuator, "max_assignments", max_assignments);
 
-        // actuator group id
-        json_t *id = json_integer(actuatorgroup->id);
-        json_object_set_new(json_actuatorgroup, "id", id);
+            // add to list
+            json_array_append_new(json_actuators, json_actuator);
+        }
 
-        // actuator group name
-        json_t *name = json_stringn(actuatorgroup->name->text, actuatorgroup->name->size);
-        json_object_set_new(json_actuatorgroup, "name", name);
+        // populate actuator groups list
+        for (int i = 0; i < device->actuatorgroups_count; i++)
+        {
+            cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[i];
+            json_t *json_actuatorgroup = json_object();
 
-        // actuator group actuators #1
-        json_t *actuator1 = json_integer(actuatorgroup->actuators_in_actuatorgroup[0]);
-        json_object_set_new(json_actuatorgroup, "actuator1", actuator1);
+            // actuator group id
+            json_t *id = json_integer(actuatorgroup->id + page_offset);
+            json_object_set_new(json_actuatorgroup, "id", id);
 
-        // actuator group actuators #2
-        json_t *actuator2 = json_integer(actuatorgroup->actuators_in_actuatorgroup[1]);
-        json_object_set_new(json_actuatorgroup, "actuator2", actuator2);
+            // actuator group name
+            int size = cc_device_page_name(device, actuatorgroup->name, page, name_buffer, sizeof(name_buffer));
+            json_t *name = json_stringn(name_buffer, size);
+            json_object_set_new(json_actuatorgroup, "name", name);
 
-        // add to list
-        json_array_append_new(json_actuatorgroups, json_actuatorgroup);
-    }
+            // actuator group actuators #1
+            json_t *actuator1 = json_integer(actuatorgroup->actuators_in_actuatorgroup[0]);
+            json_object_set_new(json_actuatorgroup, "actuator1", actuator1);
 
-    // check if we have pages and init those too
-    if (device->amount_of_pages > 1)
-    {
-        int page_actuator_id = device->actuators_count;
-        int page_actuatorgroup_id = device->actuatorgroups_count;
+            // actuator group actuators #2
+            json_t *actuator2 = json_integer(actuatorgroup->actuators_in_actuatorgroup[1]);
+            json_object_set_new(json_actuatorgroup, "actuator2", actuator2);
 
-        for (int j = 1; j < device->amount_of_pages; j++)
-        {
-            for (int i = 0; i < device->actuators_count; i++)
-            {
-                cc_actuator_t *actuator = device->actuators[page_actuator_id++];
-                json_t *json_actuator = json_object();
-
-                // actuator id
-                json_t *id = json_integer(actuator->id);
-                json_object_set_new(json_actuator, "id", id);
-
-                // actuator name
-                json_t *name = json_stringn(actuator->name->text, actuator->name->size);
-                json_object_set_new(json_actuator, "name", name);
-
-                // actuator supported modes
-                json_t *supported_modes = json_integer(actuator->supported_modes);
-                json_object_set_new(json_actuator, "supported_modes", supported_modes);
-
-                // actuator maximum assignments
-                json_t *max_assignments = json_integer(actuator->max_assignments);
-                json_object_set_new(json_actuator, "max_assignments", max_assignments);
-
-                // add to list
-                json_array_append_new(json_actuators, json_actuator);
-            }
-
-            // populate actuator groups list
-            for (int i = 0; i < device->actuatorgroups_count; i++)
-            {
-                cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[page_actuatorgroup_id++];
-                json_t *json_actuatorgroup = json_object();
-
-                // actuator group id
-                json_t *id = json_integer(actuatorgroup->id);
-                json_object_set_new(json_actuatorgroup, "id", id);
-
-                // actuator group name
-                json_t *name = json_stringn(actuatorgroup->name->text, actuatorgroup->name->size);
-                json_object_set_new(json_actuatorgroup, "name", name);
-
-                // actuator group actuators #1
-                json_t *actuator1 = json_integer(actuatorgroup->actuators_in_actuatorgroup[0]);
-                json_object_set_new(json_actuatorgroup, "actuator1", actuator1);
-
-                // actuator group actuators #2
-                json_t *actuator2 = json_integer(actuatorgroup->actuators_in_actuatorgroup[1]);
-                json_object_set_new(json_actuatorgroup, "actuator2", actuator2);
-
-                // add to list
-                json_array_append_new(json_actuatorgroups, json_actuatorgroup);
-            }
+            // add to list
+            json_array_append_new(json_actuatorgroups, json_actuatorgroup);
         }
     }
 
+    cc_device_unlock();
+
     char *str = json_dumps(root, 0);
 
     // free json object
@@ -337,6 +284,8 @@ int* cc_device_list(int filter)
     int count = 0;
     int *devices_list = malloc((CC_MAX_DEVICES + 1) * sizeof(int));
 
+    cc_device_lock();
+
     for (int i = 0; i < CC_MAX_DEVICES; i++)
     {
         if (!g_devices[i].id)
@@ -350,6 +299,8 @@ int* cc_device_list(int filter)
         }
     }
 
+    cc_device_unlock();
+
     devices_list[count] = 0;
     return devices_list;
 }
@@ -358,6 +309,8 @@ int cc_device_count(const char *uri)
 {
     int count = 0;
 
+    cc_device_lock();
+
     for (int i = 0; i < CC_MAX_DEVICES; i++)
     {
         if (!g_devices[i].id || g_devices[i].status == CC_DEVICE_DISCONNECTED)
@@ -367,6 +320,8 @@ int cc_device_count(const char *uri)
             count++;
     }
 
+    cc_device_unlock();
+
     return count;
 }
 
@@ -383,3 +338,47 @@ cc_device_t* cc_device_get(int device_id)
 
     return NULL;
 }
+
+cc_actuator_t* cc_device_actuator(const cc_device_t *device, int actuator_id, int *page)
+{
+    const int actuators_per_page = device->actuators_count + device->actuatorgroups_count;
+
+    if (!device->actuators || actuator_id < 0 || actuator_id >= actuators_per_page * device->amount_of_pages)
+        return NULL;
+
+    // actuator groups come after the actuators of each page
+    const int index = actuator_id % actuators_per_page;
+    if (index >= device->actuators_count)
+        return NULL;
+
+    if (page)
+        *page = actuator_id / actuators_per_page;
+
+    return device->actuators[index];
+}
+
+int cc_device_page_name(const cc_device_t *device, const string_t *name, int page, char *buffer, int size)
+{
+    int ret;
+
+    // the page is only shown when the device has more than one
+    if (device->amount_of_pages > 1)
+        ret = snprintf(buffer, size, "%.*s Page #%i", name->size, name->text, page + 1);
+    else
+        ret = snprintf(buffer, size, "%.*s", name->size, name->text);
+
+    if (ret < 0)
+        ret = 0;
+
+    return ret < size ? ret : size - 1;
+}
+
+void cc_device_lock(void)
+{
+    pthread_mutex_lock(&g_devices_lock);
+}
+
+void cc_device_unlock(void)
+{
+    pthread_mutex_unlock(&g_devices_lock);
+}
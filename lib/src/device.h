@@ -47,6 +47,8 @@
 
 #define CC_MAX_DEVICES  8
 
+#define MAX_ACTUATOR_PAGES      16
+
 
 /*
 ****************************************************************************************************
@@ -68,11 +70,14 @@ enum {CC_DEVICE_DISABLE, CC_DEVICE_ENABLE};
 // device descriptor actions
 enum {CC_DEVICE_DESC_REQ, CC_DEVICE_DESC_ACK};
 
+// actuators and actuator groups are held once, for the first page
+// the other pages are virtual: the id of an entry on page N is its id + N * (actuators per page)
+// and its name gets " Page #N+1" appended, see cc_device_actuator() and cc_device_page_name()
 typedef struct cc_actuator_t {
     int id;
     string_t *name;
     uint32_t supported_modes;
-    int max_assignments, assignments_count;
+    int max_assignments, assignments_count[MAX_ACTUATOR_PAGES];
 } cc_actuator_t;
 
 typedef struct cc_actuatorgroup_t {
@@ -81,6 +86,8 @@ typedef struct cc_actuatorgroup_t {
     int actuators_in_actuatorgroup[2];
 } cc_actuatorgroup_t;
 
+// the descriptor data (uri, label, actuators, actuator groups and their names) is held in a
+// single allocation, the descriptor arena, released at once when the device is destroyed
 typedef struct cc_device_t {
     int id, status, channel;
     string_t *label, *uri;
@@ -94,6 +101,7 @@ typedef struct cc_device_t {
     int enumeration_frame_item_count;
     int chain_id;
     int amount_of_pages, current_page;
+    void *descriptor;
 } cc_device_t;
 
 
@@ -121,6 +129,20 @@ int cc_device_count(const char *uri);
 // return the device pointer or NULL if id is invalid
 cc_device_t* cc_device_get(int device_id);
 
+// return the actuator of an actuator id of any page, NULL if the id isn't of an actuator
+// page: if not NULL, receives the page of the actuator id
+cc_actuator_t* cc_device_actuator(const cc_device_t *device, int actuator_id, int *page);
+
+// write the name an actuator or actuator group is displayed with on the given page
+// returns the name size, the buffer is always null terminated
+int cc_device_page_name(const cc_device_t *device, const string_t *name, int page, char *buffer, int size);
+
+// the devices lock is held while the descriptor data of a device (label, uri, actuators, actuator
+// groups and pages) is read from another thread or replaced (a new descriptor is swapped in under
+// the lock, the old one is released after it), the receiving context which swaps it reads it freely
+void cc_device_lock(void);
+void cc_device_unlock(void);
+
 
 /*
 ****************************************************************************************************
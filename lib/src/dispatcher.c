@@ -0,0 +1,324 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "dispatcher.h"
+
+
+/*
+****************************************************************************************************
+*       INTERNAL MACROS
+****************************************************************************************************
+*/
+
+#define RING_MASK   (CC_DISPATCHER_RING_SIZE - 1)
+
+// event types
+enum {EVENT_DATA_UPDATE, EVENT_DEVICE_STATUS};
+
+// how long a status event waits for a free slot before checking again, in us
+#define STATUS_WAIT 1000
+
+
+/*
+****************************************************************************************************
+*       INTERNAL CONSTANTS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL DATA TYPES
+****************************************************************************************************
+*/
+
+// the updates list is owned by the event, device events carry a copy of the device
+// sequence: order in which the events were queued, across all producers
+typedef struct cc_dispatch_event_t {
+    void (*callback)(void *arg);
+    int type;
+    union {
+        cc_update_list_t *updates;
+        cc_device_t device;
+    } payload;
+    int64_t timestamp;
+    uint32_t sequence;
+} cc_dispatch_event_t;
+
+// single producer single consumer ring
+// head is only written by the producer and tail only by the dispatcher thread
+typedef struct cc_ring_t {
+    cc_dispatch_event_t events[CC_DISPATCHER_RING_SIZE];
+    unsigned int head, tail;
+} cc_ring_t;
+
+// the events of all rings are dispatched in sequence order, dispatched is the next one to go
+struct cc_dispatcher_t {
+    cc_ring_t rings[CC_DISPATCHER_PRODUCERS];
+    pthread_t thread;
+    sem_t pending;
+    int stopping;
+    uint32_t sequence, dispatched, overflows;
+    pthread_mutex_t stats_lock;
+    cc_dispatch_stats_t stats;
+};
+
+
+/*
+****************************************************************************************************
+*       INTERNAL GLOBAL VARIABLES
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL FUNCTIONS
+****************************************************************************************************
+*/
+
+static int64_t clock_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// returns the slot for a new event or NULL if the ring is full
+// reserved: slots which must be left free, the ones kept for the device status events
+static cc_dispatch_event_t* ring_reserve(cc_dispatcher_t *dispatcher, int producer, unsigned int reserved)
+{
+    cc_ring_t *ring = &dispatcher->rings[producer];
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (ring->head - tail + reserved >= CC_DISPATCHER_RING_SIZE)
+        return NULL;
+
+    cc_dispatch_event_t *event = &ring->events[ring->head & RING_MASK];
+    event->timestamp = clock_us();
+    event->sequence = __atomic_fetch_add(&dispatcher->sequence, 1, __ATOMIC_RELAXED);
+
+    return event;
+}
+
+static void ring_commit(cc_dispatcher_t *dispatcher, int producer)
+{
+    cc_ring_t *ring = &dispatcher->rings[producer];
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+    sem_post(&dispatcher->pending);
+}
+
+static unsigned int rings_depth(cc_dispatcher_t *dispatcher)
+{
+    unsigned int depth = 0;
+
+    for (int i = 0; i < CC_DISPATCHER_PRODUCERS; i++)
+    {
+        cc_ring_t *ring = &dispatcher->rings[i];
+        depth += __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    }
+
+    return depth;
+}
+
+static void dispatch(cc_dispatcher_t *dispatcher, cc_dispatch_event_t *event)
+{
+    int64_t latency = clock_us() - event->timestamp;
+
+    if (event->type == EVENT_DATA_UPDATE)
+    {
+        event->callback(event->payload.updates);
+        cc_update_free(event->payload.updates);
+    }
+    else
+    {
+        event->callback(&event->payload.device);
+    }
+
+    pthread_mutex_lock(&dispatcher->stats_lock);
+    cc_histogram_add(&dispatcher->stats.latency, latency);
+    dispatcher->stats.dispatched++;
+    pthread_mutex_unlock(&dispatcher->stats_lock);
+}
+
+static void rings_drain(cc_dispatcher_t *dispatcher)
+{
+    unsigned int depth = rings_depth(dispatcher);
+
+    pthread_mutex_lock(&dispatcher->stats_lock);
+    if (depth > dispatcher->stats.max_depth)
+        dispatcher->stats.max_depth = depth;
+    pthread_mutex_unlock(&dispatcher->stats_lock);
+
+    // every sequence number taken is committed right after, so when the next one isn't on the
+    // rings yet its producer is about to commit it and post the semaphore again
+    for (;;)
+    {
+        cc_ring_t *ring = NULL;
+
+        for (int i = 0; i < CC_DISPATCHER_PRODUCERS && !ring; i++)
+        {
+            cc_ring_t *candidate = &dispatcher->rings[i];
+            unsigned int head = __atomic_load_n(&candidate->head, __ATOMIC_ACQUIRE);
+
+            if (candidate->tail != head &&
+                candidate->events[candidate->tail & RING_MASK].sequence == dispatcher->dispatched)
+                ring = candidate;
+        }
+
+        if (!ring)
+            break;
+
+        dispatch(dispatcher, &ring->events[ring->tail & RING_MASK]);
+        dispatcher->dispatched++;
+
+        // the slot can be reused by the producer from now on
+        __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void* dispatcher_thread(void *arg)
+{
+    cc_dispatcher_t *dispatcher = arg;
+
+    for (;;)
+    {
+        // posted once per event, a single wake up may run several of them
+        while (sem_wait(&dispatcher->pending) && errno == EINTR);
+
+        int stopping = __atomic_load_n(&dispatcher->stopping, __ATOMIC_ACQUIRE);
+
+        rings_drain(dispatcher);
+
+        if (stopping)
+            break;
+    }
+
+    return NULL;
+}
+
+
+/*
+****************************************************************************************************
+*       GLOBAL FUNCTIONS
+****************************************************************************************************
+*/
+
+cc_dispatcher_t* cc_dispatcher_new(void)
+{
+    cc_dispatcher_t *dispatcher = calloc(1, sizeof(cc_dispatcher_t));
+    if (!dispatcher)
+        return NULL;
+
+    sem_init(&dispatcher->pending, 0, 0);
+    pthread_mutex_init(&dispatcher->stats_lock, NULL);
+    cc_histogram_reset(&dispatcher->stats.latency);
+
+    if (pthread_create(&dispatcher->thread, NULL, dispatcher_thread, dispatcher) != 0)
+    {
+        sem_destroy(&dispatcher->pending);
+        pthread_mutex_destroy(&dispatcher->stats_lock);
+        free(dispatcher);
+        return NULL;
+    }
+
+    return dispatcher;
+}
+
+void cc_dispatcher_delete(cc_dispatcher_t *dispatcher)
+{
+    if (!dispatcher)
+        return;
+
+    __atomic_store_n(&dispatcher->stopping, 1, __ATOMIC_RELEASE);
+    sem_post(&dispatcher->pending);
+    pthread_join(dispatcher->thread, NULL);
+
+    sem_destroy(&dispatcher->pending);
+    pthread_mutex_destroy(&dispatcher->stats_lock);
+    free(dispatcher);
+}
+
+void cc_dispatcher_data_update(cc_dispatcher_t *dispatcher, int producer,
+    void (*callback)(void *arg), cc_update_list_t *updates)
+{
+    cc_dispatch_event_t *event = ring_reserve(dispatcher, producer, CC_DISPATCHER_STATUS_SLOTS);
+    if (!event)
+    {
+        __atomic_fetch_add(&dispatcher->overflows, 1, __ATOMIC_RELAXED);
+        cc_update_free(updates);
+        return;
+    }
+
+    event->callback = callback;
+    event->type = EVENT_DATA_UPDATE;
+    event->payload.updates = updates;
+
+    ring_commit(dispatcher, producer);
+}
+
+void cc_dispatcher_device_status(cc_dispatcher_t *dispatcher, int producer,
+    void (*callback)(void *arg), const cc_device_t *device)
+{
+    // status events are never dropped, they wait for the dispatcher if even the slots kept for
+    // them are taken (which takes more events than all devices joining and leaving)
+    cc_dispatch_event_t *event;
+    while (!(event = ring_reserve(dispatcher, producer, 0)))
+        usleep(STATUS_WAIT);
+
+    event->callback = callback;
+    event->type = EVENT_DEVICE_STATUS;
+
+    // the device may be destroyed before the callback runs
+    cc_device_t *copy = &event->payload.device;
+    *copy = *device;
+    copy->label = copy->uri = NULL;
+    copy->actuators = NULL;
+    copy->actuators_count = 0;
+    copy->assignments = NULL;
+    copy->actuatorgroups = NULL;
+    copy->actuatorgroups_count = 0;
+    copy->descriptor = NULL;
+
+    ring_commit(dispatcher, producer);
+}
+
+void cc_dispatcher_stats(cc_dispatcher_t *dispatcher, cc_dispatch_stats_t *stats)
+{
+    pthread_mutex_lock(&dispatcher->stats_lock);
+    *stats = dispatcher->stats;
+    pthread_mutex_unlock(&dispatcher->stats_lock);
+
+    stats->depth = rings_depth(dispatcher);
+    stats->overflows = __atomic_load_n(&dispatcher->overflows, __ATOMIC_RELAXED);
+}
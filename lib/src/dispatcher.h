@@ -0,0 +1,106 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CC_DISPATCHER_H
+#define CC_DISPATCHER_H
+
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include "device.h"
+#include "update.h"
+#include "stats.h"
+
+
+/*
+****************************************************************************************************
+*       MACROS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION
+****************************************************************************************************
+*/
+
+#define CC_DISPATCHER_RING_SIZE     256     // events per producer, must be a power of two
+#define CC_DISPATCHER_STATUS_SLOTS  (2 * CC_MAX_DEVICES)    // slots of each ring kept for status events
+
+
+/*
+****************************************************************************************************
+*       DATA TYPES
+****************************************************************************************************
+*/
+
+typedef struct cc_dispatcher_t cc_dispatcher_t;
+
+// event producers, each one has its own ring and must only be used by one thread at a time
+// RX: frames parser, SYNC: chain sync cycle (device timeouts)
+// the events of all producers are dispatched in the order they were queued
+enum {CC_DISPATCHER_RX, CC_DISPATCHER_SYNC, CC_DISPATCHER_PRODUCERS};
+
+
+/*
+****************************************************************************************************
+*       FUNCTION PROTOTYPES
+****************************************************************************************************
+*/
+
+// create the dispatcher and its thread, returns NULL on failure
+cc_dispatcher_t* cc_dispatcher_new(void);
+
+// run the callbacks of the events still queued and stop the dispatcher thread
+void cc_dispatcher_delete(cc_dispatcher_t *dispatcher);
+
+// queue a data update event, the dispatcher takes the ownership of the updates list
+void cc_dispatcher_data_update(cc_dispatcher_t *dispatcher, int producer,
+    void (*callback)(void *arg), cc_update_list_t *updates);
+
+// queue a device status event, the callback gets a copy of the device
+// the device may be gone by then, so only its plain fields (id, status, ...) are kept
+// status events are never dropped: data updates can't take the last slots of a ring and, if
+// even those are taken, the caller waits for the dispatcher to free one
+void cc_dispatcher_device_status(cc_dispatcher_t *dispatcher, int producer,
+    void (*callback)(void *arg), const cc_device_t *device);
+
+void cc_dispatcher_stats(cc_dispatcher_t *dispatcher, cc_dispatch_stats_t *stats);
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION ERRORS
+****************************************************************************************************
+*/
+
+#if (CC_DISPATCHER_RING_SIZE & (CC_DISPATCHER_RING_SIZE - 1)) != 0
+#error "CC_DISPATCHER_RING_SIZE must be a power of two"
+#endif
+
+#if CC_DISPATCHER_STATUS_SLOTS >= CC_DISPATCHER_RING_SIZE
+#error "CC_DISPATCHER_STATUS_SLOTS must leave room for the data updates"
+#endif
+
+#endif
@@ -86,3 +86,11 @@ int cc_handshake_check(cc_handshake_dev_t *received, cc_handshake_mod_t *respons
 
     return status;
 }
+
+int cc_handshake_link_capable(const version_t *protocol)
+{
+    if (protocol->major != CC_LINK_SETUP_MAJOR)
+        return protocol->major > CC_LINK_SETUP_MAJOR;
+
+    return protocol->minor >= CC_LINK_SETUP_MINOR;
+}
@@ -37,6 +37,10 @@
 ****************************************************************************************************
 */
 
+// first protocol version which understands the link setup command
+#define CC_LINK_SETUP_MAJOR     0
+#define CC_LINK_SETUP_MINOR     8
+
 
 /*
 ****************************************************************************************************
@@ -53,6 +57,11 @@
 
 enum {CC_HANDSHAKE_OK, CC_UPDATE_AVAILABLE, CC_UPDATE_REQUIRED};
 
+// framing modes
+// RAW: sync byte followed by the unescaped frame
+// COBS: cobs encoded frame followed by a zero delimiter
+enum {CC_FRAMING_RAW, CC_FRAMING_COBS};
+
 // handshake structure received from device
 typedef struct cc_handshake_dev_t {
     string_t *uri; // required for versions before v0.4
@@ -66,6 +75,15 @@ typedef struct cc_handshake_mod_t {
     int status, device_id;
 } cc_handshake_mod_t;
 
+// link setup structure broadcasted to all devices
+// devices switch to the new baud rate and framing right after receiving it and confirm
+// with a link setup frame after the first sync, they must go back to the default baud
+// rate and raw framing by themselves when no valid sync message arrives
+typedef struct cc_link_setup_t {
+    uint32_t baudrate;
+    int framing;
+} cc_link_setup_t;
+
 
 /*
 ****************************************************************************************************
@@ -75,6 +93,9 @@ typedef struct cc_handshake_mod_t {
 
 int cc_handshake_check(cc_handshake_dev_t *received, cc_handshake_mod_t *response);
 
+// return 1 if the protocol version supports the link setup command
+int cc_handshake_link_capable(const version_t *protocol);
+
 
 /*
 ****************************************************************************************************
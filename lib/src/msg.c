@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "control_chain.h"
 #include "msg.h"
 #include "handshake.h"
@@ -41,6 +42,108 @@
 ****************************************************************************************************
 */
 
+#define CC_MSG_LABEL_MAX        16      // assignment and list item labels
+#define CC_MSG_UNIT_MAX         8
+
+// wire format of the messages, each part is described once as a list of X(type, field)
+// u16, u32 and f32 (ieee 754) are little endian, text is the size byte followed by the characters
+// the codecs (struct, size, get and put) are generated from these lists, see WIRE_CODEC_*()
+
+// handshake received from a device, preceded by its URI before v0.4
+#define CC_WIRE_HANDSHAKE_DEV(X) \
+    X(u16, random_id) X(u8, protocol_major) X(u8, protocol_minor) \
+    X(u8, firmware_major) X(u8, firmware_minor) X(u8, firmware_micro)
+
+// handshake response
+#define CC_WIRE_HANDSHAKE_MOD(X) \
+    X(u16, random_id) X(u8, status) X(u8, device_id)
+
+// device descriptor: URI (from v0.4), label, actuators count and the actuators, then from v0.7
+// actuator groups count, the actuator groups and the pagination
+#define CC_WIRE_ACTUATOR(X) \
+    X(text, name) X(u32, supported_modes) X(u8, max_assignments)
+
+#define CC_WIRE_ACTUATORGROUP(X) \
+    X(text, name) X(u8, actuator1) X(u8, actuator2)
+
+#define CC_WIRE_PAGINATION(X) \
+    X(u8, enumeration_frame_item_count) X(u8, amount_of_pages) X(u8, chain_id)
+
+#define CC_WIRE_DEV_CONTROL(X) \
+    X(u8, control)
+
+// assignment, followed by list_count list items
+#define CC_WIRE_ASSIGNMENT(X) \
+    X(u8, assignment_id) X(u8, actuator_id) X(text, label) \
+    X(f32, value) X(f32, min) X(f32, max) X(f32, def) X(u32, mode) X(u16, steps) \
+    X(text, unit) X(u8, list_count)
+
+#define CC_WIRE_LIST_ITEM(X) \
+    X(text, label) X(f32, value)
+
+#define CC_WIRE_UNASSIGNMENT(X) \
+    X(u8, assignment_id)
+
+#define CC_WIRE_SET_VALUE(X) \
+    X(u8, assignment_id) X(u8, actuator_id) X(f32, value)
+
+// list items update, followed by the list items of the enumeration frame
+#define CC_WIRE_ENUMERATION(X) \
+    X(u8, assignment_id) X(u8, actuator_id) X(u8, list_offset)
+
+#define CC_WIRE_CONTROL_PAGE(X) \
+    X(u8, page)
+
+#define CC_WIRE_LINK_SETUP(X) \
+    X(u32, baudrate) X(u8, framing)
+
+// X(codec, fields) of all the message parts
+#define CC_WIRE_CODECS(X) \
+    X(handshake_dev, CC_WIRE_HANDSHAKE_DEV) \
+    X(handshake_mod, CC_WIRE_HANDSHAKE_MOD) \
+    X(actuator, CC_WIRE_ACTUATOR) \
+    X(actuatorgroup, CC_WIRE_ACTUATORGROUP) \
+    X(pagination, CC_WIRE_PAGINATION) \
+    X(dev_control, CC_WIRE_DEV_CONTROL) \
+    X(assignment, CC_WIRE_ASSIGNMENT) \
+    X(list_item, CC_WIRE_LIST_ITEM) \
+    X(unassignment, CC_WIRE_UNASSIGNMENT) \
+    X(set_value, CC_WIRE_SET_VALUE) \
+    X(enumeration, CC_WIRE_ENUMERATION) \
+    X(control_page, CC_WIRE_CONTROL_PAGE) \
+    X(link_setup, CC_WIRE_LINK_SETUP)
+
+// X(command, codec) of the messages built by the master
+#define CC_WIRE_TX(X) \
+    X(CC_CMD_HANDSHAKE, handshake_mod) \
+    X(CC_CMD_DEV_CONTROL, dev_control) \
+    X(CC_CMD_ASSIGNMENT, assignment) \
+    X(CC_CMD_UNASSIGNMENT, unassignment) \
+    X(CC_CMD_SET_VALUE, set_value) \
+    X(CC_CMD_UPDATE_ENUMERATION, enumeration) \
+    X(CC_CMD_LINK_SETUP, link_setup)
+
+// codec generators
+#define WIRE_FIELD(type, field)     wire_##type##_t field;
+#define WIRE_SIZE(type, field)      + wire_##type##_size(&v->field)
+#define WIRE_GET(type, field)       wire_##type##_get(r, &v->field);
+#define WIRE_PUT(type, field)       wire_##type##_put(w, &v->field);
+
+#define WIRE_CODEC_TYPE(codec, FIELDS) \
+    typedef struct wire_##codec##_t { FIELDS(WIRE_FIELD) } wire_##codec##_t;
+
+#define WIRE_CODEC_FUNCTIONS(codec, FIELDS) \
+    static inline int wire_##codec##_size(const wire_##codec##_t *v) \
+    { (void) v; return 0 FIELDS(WIRE_SIZE); } \
+    static inline void wire_##codec##_get(wire_reader_t *r, wire_##codec##_t *v) \
+    { FIELDS(WIRE_GET) } \
+    static inline void wire_##codec##_put(wire_writer_t *w, const wire_##codec##_t *v) \
+    { FIELDS(WIRE_PUT) }
+
+#define WIRE_TX_MEMBER(command, codec)  wire_##codec##_t codec;
+#define WIRE_TX_SIZE(command, codec)    case command: return wire_##codec##_size(&wire->codec);
+#define WIRE_TX_PUT(command, codec)     case command: wire_##codec##_put(w, &wire->codec); break;
+
 
 /*
 ****************************************************************************************************
@@ -48,6 +151,11 @@
 ****************************************************************************************************
 */
 
+// buffer size of each pool size class, in ascending order
+static const int g_pool_sizes[] = {CC_MSG_POOL_SMALL, CC_MSG_POOL_MEDIUM, CC_DATA_BUFFER_SIZE};
+
+#define CC_MSG_POOL_CLASSES     (sizeof (g_pool_sizes) / sizeof (g_pool_sizes[0]))
+
 
 /*
 ****************************************************************************************************
@@ -55,6 +163,45 @@
 ****************************************************************************************************
 */
 
+// pooled message, the message is the first member so it can be cast back to its block
+typedef struct cc_msg_block_t {
+    cc_msg_t msg;
+    unsigned int size_class;
+    struct cc_msg_block_t *next;
+    uint8_t buffer[];
+} cc_msg_block_t;
+
+// wire types
+typedef uint8_t wire_u8_t;
+typedef uint16_t wire_u16_t;
+typedef uint32_t wire_u32_t;
+typedef float wire_f32_t;
+
+// on decoding the text points into the message data, it's not null terminated
+typedef struct wire_text_t {
+    const char *text;
+    uint8_t size;
+} wire_text_t;
+
+// bounds checked cursors, the error flag is set by the first access which doesn't fit
+// and sticks: from then on the reads return zeros and the writes are dropped
+typedef struct wire_reader_t {
+    const uint8_t *ptr, *end;
+    int error;
+} wire_reader_t;
+
+typedef struct wire_writer_t {
+    uint8_t *ptr, *end;
+    int error;
+} wire_writer_t;
+
+CC_WIRE_CODECS(WIRE_CODEC_TYPE)
+
+// wire representation of a message built by the master
+typedef union wire_tx_t {
+    CC_WIRE_TX(WIRE_TX_MEMBER)
+} wire_tx_t;
+
 
 /*
 ****************************************************************************************************
@@ -62,6 +209,11 @@
 ****************************************************************************************************
 */
 
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static cc_msg_block_t *g_pool[CC_MSG_POOL_CLASSES];
+static int g_pool_count[CC_MSG_POOL_CLASSES];
+static cc_msg_pool_stats_t g_pool_stats;
+
 
 /*
 ****************************************************************************************************
@@ -69,40 +221,423 @@
 ****************************************************************************************************
 */
 
-static string_t *string_append_page_number(string_t *og_str, int page)
+static inline wire_reader_t wire_reader(const cc_msg_t *msg)
+{
+    const int size = msg->data_size > 0 ? msg->data_size : 0;
+    return (wire_reader_t) {.ptr = msg->data, .end = msg->data + size};
+}
+
+// consume size bytes, NULL if they don't fit
+static inline const uint8_t *wire_read(wire_reader_t *r, uint32_t size)
+{
+    if (r->error || (uint32_t) (r->end - r->ptr) < size)
+    {
+        r->error = 1;
+        return NULL;
+    }
+
+    const uint8_t *data = r->ptr;
+    r->ptr += size;
+
+    return data;
+}
+
+static inline uint8_t *wire_write(wire_writer_t *w, uint32_t size)
+{
+    if (w->error || (uint32_t) (w->end - w->ptr) < size)
+    {
+        w->error = 1;
+        return NULL;
+    }
+
+    uint8_t *data = w->ptr;
+    w->ptr += size;
+
+    return data;
+}
+
+// wire types codecs, byte wise so the data doesn't need to be aligned
+static inline int wire_u8_size(const wire_u8_t *v)
+{
+    (void) v;
+    return 1;
+}
+
+static inline void wire_u8_get(wire_reader_t *r, wire_u8_t *v)
+{
+    const uint8_t *p = wire_read(r, 1);
+    *v = p ? p[0] : 0;
+}
+
+static inline void wire_u8_put(wire_writer_t *w, const wire_u8_t *v)
+{
+    uint8_t *p = wire_write(w, 1);
+    if (p)
+        p[0] = *v;
+}
+
+static inline int wire_u16_size(const wire_u16_t *v)
+{
+    (void) v;
+    return 2;
+}
+
+static inline void wire_u16_get(wire_reader_t *r, wire_u16_t *v)
+{
+    const uint8_t *p = wire_read(r, 2);
+    *v = p ? (uint16_t) (p[0] | p[1] << 8) : 0;
+}
+
+static inline void wire_u16_put(wire_writer_t *w, const wire_u16_t *v)
+{
+    uint8_t *p = wire_write(w, 2);
+    if (p)
+    {
+        p[0] = *v;
+        p[1] = *v >> 8;
+    }
+}
+
+static inline int wire_u32_size(const wire_u32_t *v)
+{
+    (void) v;
+    return 4;
+}
+
+static inline void wire_u32_get(wire_reader_t *r, wire_u32_t *v)
+{
+    const uint8_t *p = wire_read(r, 4);
+    *v = p ? (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24 : 0;
+}
+
+static inline void wire_u32_put(wire_writer_t *w, const wire_u32_t *v)
+{
+    uint8_t *p = wire_write(w, 4);
+    if (p)
+    {
+        p[0] = *v;
+        p[1] = *v >> 8;
+        p[2] = *v >> 16;
+        p[3] = *v >> 24;
+    }
+}
+
+static inline int wire_f32_size(const wire_f32_t *v)
+{
+    (void) v;
+    return 4;
+}
+
+static inline void wire_f32_get(wire_reader_t *r, wire_f32_t *v)
+{
+    wire_u32_t bits;
+    wire_u32_get(r, &bits);
+    memcpy(v, &bits, sizeof (float));
+}
+
+static inline void wire_f32_put(wire_writer_t *w, const wire_f32_t *v)
+{
+    wire_u32_t bits;
+    memcpy(&bits, v, sizeof (float));
+    wire_u32_put(w, &bits);
+}
+
+static inline int wire_text_size(const wire_text_t *v)
+{
+    return 1 + v->size;
+}
+
+static inline void wire_text_get(wire_reader_t *r, wire_text_t *v)
+{
+    wire_u8_get(r, &v->size);
+    v->text = (const char *) wire_read(r, v->size);
+    if (!v->text)
+        v->size = 0;
+}
+
+static inline void wire_text_put(wire_writer_t *w, const wire_text_t *v)
+{
+    wire_u8_put(w, &v->size);
+    uint8_t *p = wire_write(w, v->size);
+    if (p && v->size)
+        memcpy(p, v->text, v->size);
+}
+
+CC_WIRE_CODECS(WIRE_CODEC_FUNCTIONS)
+
+// length of a string as serialized, truncated to max
+static int text_size(const char *text, int max)
+{
+    int size = text ? strlen(text) : 0;
+    return size > max ? max : size;
+}
+
+static wire_text_t wire_text(const char *text, int max)
+{
+    return (wire_text_t) {.text = text, .size = text_size(text, max)};
+}
+
+// string copy of a wire text, allocated from the arena if given
+static string_t *text_string(arena_t *arena, const wire_text_t *text)
+{
+    string_t *str = arena ? arena_alloc(arena, sizeof (string_t)) : malloc(sizeof (string_t));
+    if (!str)
+        return NULL;
+
+    str->size = text->size;
+    str->text = arena ? arena_alloc(arena, text->size + 1) : malloc(text->size + 1);
+    if (!str->text)
+    {
+        if (!arena)
+            free(str);
+
+        return NULL;
+    }
+
+    memcpy(str->text, text->text, text->size);
+    str->text[text->size] = 0;
+
+    return str;
+}
+
+// walk the device descriptor and return the arena size needed to hold it, -1 if it's malformed
+static int descriptor_arena_size(const cc_msg_t *msg, const cc_device_t *device)
 {
-    string_t *str = malloc(sizeof(string_t));
+    wire_reader_t r = wire_reader(msg);
+    wire_text_t text;
+    wire_u8_t count[2] = {0, 0};
+    uint32_t size = 0;
 
-    if (str)
+    // URI (starting from v0.4) and label
+    if (device->protocol.major > 0 || device->protocol.minor >= 4)
     {
-        str->size = og_str->size + (page >= 10 ? 9 : 8);
-        str->text = malloc(str->size + 1);
-        if (str->text)
+        wire_text_get(&r, &text);
+        size += STRING_ARENA_SIZE(text.size);
+    }
+
+    wire_text_get(&r, &text);
+    size += STRING_ARENA_SIZE(text.size);
+
+    // actuators
+    wire_u8_get(&r, &count[0]);
+    for (int i = 0; i < count[0] && !r.error; i++)
+    {
+        wire_actuator_t actuator;
+        wire_actuator_get(&r, &actuator);
+        size += ARENA_ALIGN(sizeof(cc_actuator_t)) + STRING_ARENA_SIZE(actuator.name.size);
+    }
+
+    // actuatorgroups, pagination and chain-id (starting from v0.7)
+    if (device->protocol.major > 0 || device->protocol.minor >= 7)
+    {
+        wire_u8_get(&r, &count[1]);
+        for (int i = 0; i < count[1] && !r.error; i++)
         {
-            memcpy(str->text, og_str->text, og_str->size);
-            memcpy(str->text + og_str->size, " Page #", 7);
-            if (page >= 10)
-            {
-                str->text[og_str->size + 7] = '0' + (int)(page / 10);
-                str->text[og_str->size + 8] = '0' + (page % 10);
-                str->text[og_str->size + 9] = 0;
-            }
-            else
-            {
-                str->text[og_str->size + 7] = '1' + page;
-                str->text[og_str->size + 8] = 0;
-            }
+            wire_actuatorgroup_t actuatorgroup;
+            wire_actuatorgroup_get(&r, &actuatorgroup);
+            size += ARENA_ALIGN(sizeof(cc_actuatorgroup_t)) + STRING_ARENA_SIZE(actuatorgroup.name.size);
         }
-        else
+
+        wire_pagination_t pagination;
+        wire_pagination_get(&r, &pagination);
+    }
+
+    if (r.error)
+        return -1;
+
+    // pointers lists, the pages are virtual so each entry is held once
+    for (int k = 0; k < 2; k++)
+    {
+        if (count[k] > 0)
+            size += ARENA_ALIGN(sizeof(void *) * count[k]);
+    }
+
+    return size;
+}
+
+// list items count of an assignment message
+static int assignment_list_count(const cc_assignment_t *assignment)
+{
+    int list_count = assignment->enumeration_frame_max - assignment->enumeration_frame_min;
+
+    if (list_count == 0)
+        list_count = assignment->list_count;
+
+    // cannot be bigger than 1 byte
+    if (list_count > 0xff)
+        list_count = 0xff;
+
+    return list_count;
+}
+
+// end of the list items range sent in an assignment message
+static int assignment_list_max(const cc_assignment_t *assignment, int list_count)
+{
+    return assignment->enumeration_frame_max ? assignment->enumeration_frame_max : list_count;
+}
+
+static wire_list_item_t list_item_wire(const cc_item_t *item)
+{
+    return (wire_list_item_t) {.label = wire_text(item->label, CC_MSG_LABEL_MAX), .value = item->value};
+}
+
+// size of the list items in the range
+static int items_size(const cc_assignment_t *assignment, int first, int last)
+{
+    int size = 0;
+
+    for (int i = first; i < last; i++)
+    {
+        wire_list_item_t item = list_item_wire(assignment->list_items[i]);
+        size += wire_list_item_size(&item);
+    }
+
+    return size;
+}
+
+static void items_put(wire_writer_t *w, const cc_assignment_t *assignment, int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        wire_list_item_t item = list_item_wire(assignment->list_items[i]);
+        wire_list_item_put(w, &item);
+    }
+}
+
+// actuator id as known by the device, the actuators of the other pages are sent as the ones of
+// the current page
+static uint8_t actuator_wire_id(const cc_device_t *device, int actuator_id)
+{
+    uint8_t id = actuator_id;
+
+    if (device)
+    {
+        cc_device_lock();
+
+        uint8_t actuators_per_page = device->actuators_count + device->actuatorgroups_count;
+
+        if (id >= actuators_per_page)
+            id -= actuators_per_page * device->current_page;
+
+        cc_device_unlock();
+    }
+
+    return id;
+}
+
+// fill the wire representation of a message built by the master, returns its device id
+// the list items range which follows the message, if any, is returned in first and last
+static int tx_wire(int command, const void *data_struct, int device_id, wire_tx_t *wire,
+    int *first, int *last)
+{
+    *first = *last = 0;
+
+    if (command == CC_CMD_HANDSHAKE)
+    {
+        const cc_handshake_mod_t *handshake = data_struct;
+
+        wire->handshake_mod = (wire_handshake_mod_t) {
+            .random_id = handshake->random_id,
+            .status = handshake->status,
+            .device_id = handshake->device_id
+        };
+    }
+    else if (command == CC_CMD_DEV_CONTROL)
+    {
+        const int *control = data_struct;
+        wire->dev_control.control = *control;
+    }
+    else if (command == CC_CMD_ASSIGNMENT)
+    {
+        const cc_assignment_t *assignment = data_struct;
+        const cc_device_t *device = cc_device_get(assignment->device_id);
+        const int list_count = assignment_list_count(assignment);
+
+        wire->assignment = (wire_assignment_t) {
+            .assignment_id = assignment->id,
+            .actuator_id = actuator_wire_id(device, assignment->actuator_id),
+            .label = wire_text(assignment->label, CC_MSG_LABEL_MAX),
+            .value = assignment->value,
+            .min = assignment->min,
+            .max = assignment->max,
+            .def = assignment->def,
+            .mode = assignment->mode,
+            .steps = assignment->steps,
+            .unit = wire_text(assignment->unit, CC_MSG_UNIT_MAX),
+            .list_count = list_count
+        };
+
+        if (list_count)
         {
-            free(str);
-            str = NULL;
+            *first = assignment->enumeration_frame_min;
+            *last = assignment_list_max(assignment, list_count);
         }
 
-        string_destroy(og_str);
+        device_id = assignment->device_id;
     }
+    else if (command == CC_CMD_UNASSIGNMENT)
+    {
+        const cc_assignment_key_t *assignment = data_struct;
 
-    return str;
+        wire->unassignment.assignment_id = assignment->id;
+        device_id = assignment->device_id;
+    }
+    else if (command == CC_CMD_SET_VALUE)
+    {
+        const cc_set_value_t *update = data_struct;
+        const cc_device_t *device = cc_device_get(update->device_id);
+
+        wire->set_value = (wire_set_value_t) {
+            .assignment_id = update->assignment_id,
+            .actuator_id = actuator_wire_id(device, update->actuator_id),
+            .value = update->value
+        };
+
+        device_id = update->device_id;
+    }
+    else if (command == CC_CMD_UPDATE_ENUMERATION)
+    {
+        const cc_assignment_t *assignment = data_struct;
+
+        wire->enumeration = (wire_enumeration_t) {
+            .assignment_id = assignment->id,
+            .actuator_id = assignment->actuator_id,
+            .list_offset = assignment->list_index - assignment->enumeration_frame_min
+        };
+
+        *first = assignment->enumeration_frame_min;
+        *last = assignment->enumeration_frame_max;
+        device_id = assignment->device_id;
+    }
+    else if (command == CC_CMD_LINK_SETUP)
+    {
+        const cc_link_setup_t *setup = data_struct;
+
+        wire->link_setup = (wire_link_setup_t) {
+            .baudrate = setup->baudrate,
+            .framing = setup->framing
+        };
+    }
+
+    return device_id;
+}
+
+static int tx_wire_size(int command, const wire_tx_t *wire)
+{
+    switch (command)
+    {
+        CC_WIRE_TX(WIRE_TX_SIZE)
+    }
+
+    return 0;
+}
+
+static void tx_wire_put(wire_writer_t *w, int command, const wire_tx_t *wire)
+{
+    switch (command)
+    {
+        CC_WIRE_TX(WIRE_TX_PUT)
+    }
 }
 
 /*
@@ -113,8 +648,52 @@ static string_t *string_append_page_number(string_t *og_str, int page)
 
 cc_msg_t* cc_msg_new(void)
 {
-    cc_msg_t *msg = calloc(1, sizeof(cc_msg_t));
-    msg->header = calloc(1, CC_DATA_BUFFER_SIZE);
+    return cc_msg_new_size(CC_DATA_BUFFER_SIZE - CC_MSG_HEADER_SIZE);
+}
+
+cc_msg_t* cc_msg_new_size(int data_size)
+{
+    if (data_size < 0 || data_size > CC_DATA_BUFFER_SIZE - CC_MSG_HEADER_SIZE)
+        return NULL;
+
+    // smallest size class which fits the message
+    unsigned int size_class = 0;
+    while (g_pool_sizes[size_class] < CC_MSG_HEADER_SIZE + data_size)
+        size_class++;
+
+    pthread_mutex_lock(&g_pool_lock);
+
+    cc_msg_block_t *block = g_pool[size_class];
+    if (block)
+    {
+        g_pool[size_class] = block->next;
+        g_pool_count[size_class]--;
+        g_pool_stats.hits++;
+        g_pool_stats.in_use++;
+    }
+
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (!block)
+    {
+        block = malloc(sizeof (cc_msg_block_t) + g_pool_sizes[size_class]);
+        if (!block)
+            return NULL;
+
+        block->size_class = size_class;
+
+        pthread_mutex_lock(&g_pool_lock);
+        g_pool_stats.misses++;
+        g_pool_stats.in_use++;
+        pthread_mutex_unlock(&g_pool_lock);
+    }
+
+    // the buffer is reused as it is, only the fields are reset
+    cc_msg_t *msg = &block->msg;
+    msg->device_id = 0;
+    msg->command = 0;
+    msg->data_size = 0;
+    msg->header = block->buffer;
     msg->data = &msg->header[CC_MSG_HEADER_SIZE];
 
     return msg;
@@ -122,59 +701,114 @@ cc_msg_t* cc_msg_new(void)
 
 void cc_msg_delete(cc_msg_t *msg)
 {
-    if (msg)
+    if (!msg)
+        return;
+
+    cc_msg_block_t *block = (cc_msg_block_t *) msg;
+    const unsigned int size_class = block->size_class;
+
+    pthread_mutex_lock(&g_pool_lock);
+
+    g_pool_stats.in_use--;
+
+    if (g_pool_count[size_class] < CC_MSG_POOL_DEPTH)
     {
-        free(msg->header);
-        free(msg);
+        block->next = g_pool[size_class];
+        g_pool[size_class] = block;
+        g_pool_count[size_class]++;
+        block = NULL;
     }
+
+    pthread_mutex_unlock(&g_pool_lock);
+
+    // pool is full
+    free(block);
 }
 
-void cc_msg_parser(const cc_msg_t *msg, void *data_struct)
+cc_msg_t* cc_msg_dup(const cc_msg_t *msg)
 {
+    cc_msg_t *copy = cc_msg_new_size(msg->data_size);
+    if (!copy)
+        return NULL;
+
+    copy->device_id = msg->device_id;
+    copy->command = msg->command;
+    copy->data_size = msg->data_size;
+    memcpy(copy->data, msg->data, msg->data_size);
+
+    return copy;
+}
+
+int cc_msg_parser(const cc_msg_t *msg, void *data_struct)
+{
+    wire_reader_t r = wire_reader(msg);
+
     if (msg->command == CC_CMD_HANDSHAKE)
     {
         cc_handshake_dev_t *handshake = data_struct;
-        uint8_t *pdata = msg->data;
+        handshake->uri = NULL;
 
         // old versions of protocol (before v0.4) used to sent the URI during the handshake
         // assume the URI is within the hanshake if data size > 7 bytes
         if (msg->data_size > 7)
         {
-            uint32_t size;
-            handshake->uri = string_deserialize(pdata, &size);
-            pdata += size;
+            wire_text_t uri;
+            wire_text_get(&r, &uri);
+
+            if (!r.error)
+                handshake->uri = text_string(NULL, &uri);
         }
-        else
+
+        wire_handshake_dev_t wire;
+        wire_handshake_dev_get(&r, &wire);
+
+        if (r.error)
         {
-            handshake->uri = 0;
+            string_destroy(handshake->uri);
+            handshake->uri = NULL;
+            return -1;
         }
 
         // random id
-        handshake->random_id = *((uint16_t *) pdata);
-        pdata += sizeof(uint16_t);
+        handshake->random_id = wire.random_id;
 
         // device protocol version
-        handshake->protocol.major = *pdata++;
-        handshake->protocol.minor = *pdata++;
+        handshake->protocol.major = wire.protocol_major;
+        handshake->protocol.minor = wire.protocol_minor;
         handshake->protocol.micro = 0;
 
         // device firmware version
-        handshake->firmware.major = *pdata++;
-        handshake->firmware.minor = *pdata++;
-        handshake->firmware.micro = *pdata++;
+        handshake->firmware.major = wire.firmware_major;
+        handshake->firmware.minor = wire.firmware_minor;
+        handshake->firmware.micro = wire.firmware_micro;
     }
     else if (msg->command == CC_CMD_DEV_DESCRIPTOR)
     {
-        cc_device_t *device = data_struct;
-        uint8_t *pdata = msg->data;
-        uint32_t i = 0;
+        cc_device_t *target = data_struct;
+        wire_text_t text;
+        wire_u8_t count;
+
+        // the whole descriptor is held in a single arena, sized from the frame
+        int size = descriptor_arena_size(msg, target);
+        if (size <= 0)
+            return -1;
+
+        arena_t arena = {.buffer = malloc(size), .size = size};
+        if (!arena.buffer)
+            return -1;
+
+        // the new descriptor is built aside, the device keeps the previous one until it's complete
+        cc_device_t parsed = *target;
+        cc_device_t *device = &parsed;
+
+        device->descriptor = arena.buffer;
 
         // URI was added to device descriptor starting from v0.4
         if (device->protocol.major > 0 || device->protocol.minor >= 4)
         {
             // URI
-            device->uri = string_deserialize(pdata, &i);
-            pdata += i;
+            wire_text_get(&r, &text);
+            device->uri = text_string(&arena, &text);
 
             // device channel
             device->channel = cc_device_count(device->uri->text);
@@ -186,37 +820,35 @@ void cc_msg_parser(const cc_msg_t *msg, void *data_struct)
         }
 
         // device label
-        device->label = string_deserialize(pdata, &i);
-        pdata += i;
+        wire_text_get(&r, &text);
+        string_t *label = text_string(&arena, &text);
 
         // number of actuators
+        wire_u8_get(&r, &count);
         device->actuators = NULL;
-        device->actuators_count = *pdata++;
+        device->actuators_count = count;
 
         // list of actuators
         if (device->actuators_count > 0)
         {
-            device->actuators = malloc(sizeof(cc_actuator_t *) * (device->actuators_count * MAX_ACTUATOR_PAGES));
+            device->actuators = arena_alloc(&arena, sizeof(cc_actuator_t *) * device->actuators_count);
 
             for (int j = 0; j < device->actuators_count; j++)
             {
-                device->actuators[j] = malloc(sizeof(cc_actuator_t));
+                device->actuators[j] = arena_alloc(&arena, sizeof(cc_actuator_t));
                 cc_actuator_t *actuator = device->actuators[j];
 
-                // actuator id
-                actuator->id = j;
-
-                // actuator name
-                actuator->name = string_deserialize(pdata, &i);
-                pdata += i;
+                wire_actuator_t wire;
+                wire_actuator_get(&r, &wire);
 
-                // actuator supported modes
-                actuator->supported_modes = *((uint32_t *) pdata);
-                pdata += sizeof(uint32_t);
+                // actuator id, name, supported modes
+                actuator->id = j;
+                actuator->name = text_string(&arena, &wire.name);
+                actuator->supported_modes = wire.supported_modes;
 
-                // actuator assignments counter and maximum value
-                actuator->max_assignments = *pdata++;
-                actuator->assignments_count = 0;
+                // actuator assignments counters (one per page) and maximum value
+                actuator->max_assignments = wire.max_assignments;
+                memset(actuator->assignments_count, 0, sizeof(actuator->assignments_count));
             }
         }
 
@@ -224,90 +856,54 @@ void cc_msg_parser(const cc_msg_t *msg, void *data_struct)
         if (device->protocol.major > 0 || device->protocol.minor >= 7)
         {
             // number of actuatorgroups
+            wire_u8_get(&r, &count);
             device->actuatorgroups = NULL;
-            device->actuatorgroups_count = *pdata++;
+            device->actuatorgroups_count = count;
 
             // list of actuatorgroups
             int actuatorgroup_id = device->actuators_count;
 
             if (device->actuatorgroups_count > 0)
             {
-                device->actuatorgroups = malloc(sizeof(cc_actuatorgroup_t *) * (device->actuatorgroups_count * MAX_ACTUATOR_PAGES));
+                device->actuatorgroups = arena_alloc(&arena, sizeof(cc_actuatorgroup_t *) * device->actuatorgroups_count);
 
                 for (int j = 0; j < device->actuatorgroups_count; j++)
                 {
-                    device->actuatorgroups[j] = malloc(sizeof(cc_actuatorgroup_t));
+                    device->actuatorgroups[j] = arena_alloc(&arena, sizeof(cc_actuatorgroup_t));
                     cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[j];
 
-                    // actuator group id
-                    actuatorgroup->id = actuatorgroup_id;
-
-                    // actuator group name
-                    actuatorgroup->name = string_deserialize(pdata, &i);
-                    pdata += i;
+                    wire_actuatorgroup_t wire;
+                    wire_actuatorgroup_get(&r, &wire);
 
-                    // actuators in actuator group
-                    actuatorgroup->actuators_in_actuatorgroup[0] = *pdata++;
-                    actuatorgroup->actuators_in_actuatorgroup[1] = *pdata++;
+                    // actuator group id, name and actuators in the group
+                    actuatorgroup->id = actuatorgroup_id;
+                    actuatorgroup->name = text_string(&arena, &wire.name);
+                    actuatorgroup->actuators_in_actuatorgroup[0] = wire.actuator1;
+                    actuatorgroup->actuators_in_actuatorgroup[1] = wire.actuator2;
 
                     actuatorgroup_id++;
                 }
             }
 
             // pagination
-            device->enumeration_frame_item_count = *pdata++;
+            wire_pagination_t wire;
+            wire_pagination_get(&r, &wire);
+
+            device->enumeration_frame_item_count = wire.enumeration_frame_item_count;
 
             // must be >= 2
             if (device->enumeration_frame_item_count <= 1)
                 device->enumeration_frame_item_count = 0;
 
-            device->amount_of_pages = *pdata++;
+            device->amount_of_pages = wire.amount_of_pages;
             device->current_page = 0;
 
-            // check if we have pages
+            // the other pages are virtual, see cc_device_actuator()
             if (device->amount_of_pages > 1)
             {
                 // limit amount of pages to what is supported on server side
                 if (device->amount_of_pages > MAX_ACTUATOR_PAGES)
                     device->amount_of_pages = MAX_ACTUATOR_PAGES;
-
-                // create the other actuator pages
-                int page_actuator_id = device->actuators_count + device->actuatorgroups_count;
-
-                for (int j = 1; j < device->amount_of_pages; j++)
-                {
-                    for (int q = 0; q < device->actuators_count; q++, page_actuator_id++)
-                    {
-                        cc_actuator_t *actuator = malloc(sizeof(cc_actuator_t));
-                        device->actuators[j * device->actuators_count + q] = actuator;
-
-                        memcpy(actuator, device->actuators[q], sizeof(cc_actuator_t));
-                        actuator->id = page_actuator_id;
-                        actuator->name = string_append_page_number(string_create(actuator->name->text), j);
-                    }
-
-                    for (int q = 0; q < device->actuatorgroups_count; q++, page_actuator_id++)
-                    {
-                        cc_actuatorgroup_t *actuatorgroup = malloc(sizeof(cc_actuatorgroup_t));
-                        device->actuatorgroups[j * device->actuatorgroups_count + q] = actuatorgroup;
-
-                        memcpy(actuatorgroup, device->actuatorgroups[q], sizeof(cc_actuatorgroup_t));
-                        actuatorgroup->id = page_actuator_id;
-                        actuatorgroup->name = string_append_page_number(string_create(device->actuatorgroups[q]->name->text), j);
-                    }
-                }
-
-                // 'fix' the names of the page 1 actuators
-                for (int j = 0; j < device->actuators_count; j++)
-                {
-                    cc_actuator_t *actuator = device->actuators[j];
-                    actuator->name = string_append_page_number(actuator->name, 0);
-                }
-                for (int j = 0; j < device->actuatorgroups_count; j++)
-                {
-                    cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[j];
-                    actuatorgroup->name = string_append_page_number(actuatorgroup->name, 0);
-                }
             }
             else
             {
@@ -315,7 +911,7 @@ void cc_msg_parser(const cc_msg_t *msg, void *data_struct)
                 device->amount_of_pages = 1;
             }
 
-            device->chain_id = *pdata++;
+            device->chain_id = wire.chain_id;
         }
         else
         {
@@ -326,219 +922,107 @@ void cc_msg_parser(const cc_msg_t *msg, void *data_struct)
             device->current_page = 0;
             device->chain_id = 0;
         }
-    }
-    else if (msg->command == CC_CMD_DATA_UPDATE)
-    {
-        cc_update_list_t **updates = data_struct;
-        *updates = cc_update_parse(msg->device_id, msg->data, false);
-    }
-    else if (msg->command == CC_CMD_REQUEST_CONTROL_PAGE)
-    {
-        //recieved command
-        uint8_t *pdata = msg->data;
-        int *page_to_load = data_struct;
-
-        *page_to_load = *pdata++;
-    }
-}
-
-cc_msg_t* cc_msg_builder(int device_id, int command, const void *data_struct)
-{
-    cc_msg_t *msg = cc_msg_new();
-
-    uint8_t *pdata = msg->data;
-    msg->device_id = device_id;
-    msg->command = command;
-
-    if (command == CC_CMD_HANDSHAKE)
-    {
-        const cc_handshake_mod_t *handshake = data_struct;
-
-        // random id
-        uint16_t *random_id = (uint16_t *) pdata;
-        *random_id = handshake->random_id;
-        pdata += 2;
-
-        // status, device id
-        *pdata++ = handshake->status;
-        *pdata++ = handshake->device_id;
-    }
-    else if (command == CC_CMD_DEV_CONTROL)
-    {
-        const int *control = data_struct;
-        *pdata++ = *control;
-    }
-    else if (command == CC_CMD_ASSIGNMENT)
-    {
-        const cc_assignment_t *assignment = data_struct;
-        const cc_device_t *device = cc_device_get(assignment->device_id);
-
-        // device id
-        msg->device_id = assignment->device_id;
-
-        // assignment id
-        *pdata++ = assignment->id;
-
-        // actuator id
-        uint8_t actuators_per_page = device->actuators_count + device->actuatorgroups_count;
-        uint8_t actuator_id = assignment->actuator_id;
-
-        if (actuator_id >= actuators_per_page)
-            actuator_id -= actuators_per_page * device->current_page;
-
-        *pdata++ = actuator_id;
-
-        // assignment label
-        if (assignment->label)
-        {
-            int size = strlen(assignment->label);
-            if (size > 16)
-                size = 16;
-            *pdata++ = size;
-            memcpy(pdata, assignment->label, size);
-            pdata += size;
-        }
-        else
-        {
-            *pdata++ = 0;
-        }
-
-        // value, min, max, def
-        pdata += float_to_bytes(assignment->value, pdata);
-        pdata += float_to_bytes(assignment->min, pdata);
-        pdata += float_to_bytes(assignment->max, pdata);
-        pdata += float_to_bytes(assignment->def, pdata);
-
-        // mode
-        uint32_t *mode = (uint32_t *) pdata;
-        *mode = assignment->mode;
-        pdata += sizeof(uint32_t);
 
-        // steps
-        uint16_t *steps = (uint16_t *) pdata;
-        *steps = assignment->steps;
-        pdata += sizeof(uint16_t);
-
-        // unit
-        if (assignment->unit)
+        // the descriptor was validated when sizing the arena
+        if (r.error)
         {
-            int size = strlen(assignment->unit);
-            if (size > 8)
-                size = 8;
-            *pdata++ = size;
-            memcpy(pdata, assignment->unit, size);
-            pdata += size;
+            free(arena.buffer);
+            return -1;
         }
-        else
-        {
-            *pdata++ = 0;
-        }
-
-        // list count
-        int list_count = assignment->enumeration_frame_max - assignment->enumeration_frame_min;
 
-        if (list_count == 0)
-            list_count = assignment->list_count;
+        // replace the previous descriptor or the URI received with the handshake
+        // readers of the device hold the devices lock, so the old one is only released after the swap
+        void *previous = target->descriptor;
+        string_t *handshake_uri = previous ? NULL : target->uri;
 
-        // cannot be bigger than 1 byte
-        if (list_count > 0xff)
-            list_count = 0xff;
+        cc_device_lock();
 
-        *pdata++ = list_count;
+        target->descriptor = parsed.descriptor;
+        target->uri = parsed.uri;
+        target->channel = parsed.channel;
+        target->actuators = parsed.actuators;
+        target->actuators_count = parsed.actuators_count;
+        target->actuatorgroups = parsed.actuatorgroups;
+        target->actuatorgroups_count = parsed.actuatorgroups_count;
+        target->enumeration_frame_item_count = parsed.enumeration_frame_item_count;
+        target->amount_of_pages = parsed.amount_of_pages;
+        target->current_page = parsed.current_page;
+        target->chain_id = parsed.chain_id;
 
-        // list items
-        if (list_count)
-        {
-            const int list_max = assignment->enumeration_frame_max ? assignment->enumeration_frame_max : list_count;
-
-            for (int i = assignment->enumeration_frame_min; i < list_max; i++)
-            {
-                const cc_item_t *item = assignment->list_items[i];
-
-                // item label size
-                int size = strlen(item->label);
-                if (size > 16)
-                    size = 16;
-                *pdata++ = size;
+        // the device is registered from now on
+        target->label = label;
 
-                // item label
-                memcpy(pdata, item->label, size);
-                pdata += size;
+        cc_device_unlock();
 
-                // item value
-                pdata += float_to_bytes(item->value, pdata);
-            }
-        }
+        if (previous)
+            free(previous);
+        else
+            string_destroy(handshake_uri);
     }
-    else if (command == CC_CMD_UNASSIGNMENT)
+    else if (msg->command == CC_CMD_DATA_UPDATE)
     {
-        const cc_assignment_key_t *assignment = data_struct;
-
-        // device id
-        msg->device_id = assignment->device_id;
+        cc_update_list_t **updates = data_struct;
+        *updates = cc_update_parse(msg->device_id, msg->data, msg->data_size, false);
 
-        // assignment id
-        *pdata++ = assignment->id;
+        if (!*updates)
+            return -1;
     }
-    else if (command == CC_CMD_SET_VALUE)
+    else if (msg->command == CC_CMD_REQUEST_CONTROL_PAGE)
     {
-        const cc_set_value_t *update = data_struct;
-        cc_device_t *device = cc_device_get(update->device_id);
+        int *page_to_load = data_struct;
 
-        // device id
-        msg->device_id = update->device_id;
+        wire_control_page_t wire;
+        wire_control_page_get(&r, &wire);
 
-        // assignment id
-        *pdata++ = update->assignment_id;
+        if (r.error)
+            return -1;
 
-        // actuator id
-        uint8_t actuators_per_page = device->actuators_count + device->actuatorgroups_count;
-        uint8_t actuator_id = update->actuator_id;
+        *page_to_load = wire.page;
+    }
 
-        if (actuator_id >= actuators_per_page)
-            actuator_id = update->actuator_id - (actuators_per_page * device->current_page);
+    return 0;
+}
 
-        *pdata++ = actuator_id;
+int cc_msg_data_size(int command, const void *data_struct)
+{
+    wire_tx_t wire;
+    int first, last;
 
-        // value
-        pdata += float_to_bytes(update->value, pdata);
-    }
-    else if (command == CC_CMD_UPDATE_ENUMERATION)
-    {
-        const cc_assignment_t *assignment = data_struct;
+    tx_wire(command, data_struct, 0, &wire, &first, &last);
 
-        // device id
-        msg->device_id = assignment->device_id;
+    return tx_wire_size(command, &wire) + items_size(data_struct, first, last);
+}
 
-        // assignment id, actuator id
-        *pdata++ = assignment->id;
-        *pdata++ = assignment->actuator_id;
+cc_msg_t* cc_msg_builder(int device_id, int command, const void *data_struct)
+{
+    // the buffer is sized exactly, too big messages are not built rather than truncated
+    cc_msg_t *msg = cc_msg_new_size(cc_msg_data_size(command, data_struct));
+    if (!msg)
+        return NULL;
 
-        // list offset
-        *pdata++ = assignment->list_index - assignment->enumeration_frame_min;
+    cc_msg_encode(msg, device_id, command, data_struct);
 
-        for (int i = assignment->enumeration_frame_min; i < assignment->enumeration_frame_max; i++)
-        {
-            const cc_item_t *item = assignment->list_items[i];
+    return msg;
+}
 
-            // item label size
-            int size = strlen(item->label);
-            if (size > 16)
-                size = 16;
-            *pdata++ = size;
+int cc_msg_encode(cc_msg_t *msg, int device_id, int command, const void *data_struct)
+{
+    wire_tx_t wire;
+    int first, last;
 
-            // item label
-            memcpy(pdata, item->label, size);
-            pdata += size;
+    msg->device_id = tx_wire(command, data_struct, device_id, &wire, &first, &last);
+    msg->command = command;
 
-            // list offset
-            pdata += float_to_bytes(item->value, pdata);
-        }
-    }
+    // the writer is bounded to the size the message was sized for
+    const int data_size = tx_wire_size(command, &wire) + items_size(data_struct, first, last);
+    wire_writer_t w = {.ptr = msg->data, .end = msg->data + data_size};
 
-    msg->data_size = (pdata - msg->data);
+    tx_wire_put(&w, command, &wire);
+    items_put(&w, data_struct, first, last);
 
-    return msg;
+    msg->data_size = w.ptr - msg->data;
+
+    return msg->data_size;
 }
 
 void cc_msg_print(const char *header, const cc_msg_t *msg)
@@ -556,7 +1040,7 @@ void cc_msg_print(const char *header, const cc_msg_t *msg)
         return;
 
     static const char *commands[] = {"sync", "handshake", "device control", "device descriptor",
-        "assignment", "data update", "unassignment", "set value", "update list items", "request control page"};
+        "assignment", "data update", "unassignment", "set value", "update list items", "request control page", "link setup"};
 
     if (msg->command == CC_CMD_CHAIN_SYNC)
         return;
@@ -589,3 +1073,16 @@ void cc_msg_print(const char *header, const cc_msg_t *msg)
 
     printf("\n---\n");
 }
+
+void cc_msg_pool_stats(cc_msg_pool_stats_t *stats)
+{
+    pthread_mutex_lock(&g_pool_lock);
+
+    *stats = g_pool_stats;
+    stats->cached = 0;
+
+    for (unsigned int i = 0; i < CC_MSG_POOL_CLASSES; i++)
+        stats->cached += g_pool_count[i];
+
+    pthread_mutex_unlock(&g_pool_lock);
+}
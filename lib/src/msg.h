@@ -28,6 +28,7 @@
 */
 
 #include <stdint.h>
+#include "stats.h"
 
 
 /*
@@ -46,6 +47,11 @@
 ****************************************************************************************************
 */
 
+// messages are kept for reuse by size class, the buffer sizes include the header
+#define CC_MSG_POOL_SMALL       64
+#define CC_MSG_POOL_MEDIUM      512
+#define CC_MSG_POOL_DEPTH       32      // free messages kept per size class
+
 
 /*
 ****************************************************************************************************
@@ -56,7 +62,8 @@
 // commands definition
 enum cc_cmd_t {CC_CMD_CHAIN_SYNC, CC_CMD_HANDSHAKE, CC_CMD_DEV_CONTROL, CC_CMD_DEV_DESCRIPTOR,
                CC_CMD_ASSIGNMENT, CC_CMD_DATA_UPDATE, CC_CMD_UNASSIGNMENT, CC_CMD_SET_VALUE,
-               CC_CMD_UPDATE_ENUMERATION, CC_CMD_REQUEST_CONTROL_PAGE, CC_NUM_COMMANDS};
+               CC_CMD_UPDATE_ENUMERATION, CC_CMD_REQUEST_CONTROL_PAGE, CC_CMD_LINK_SETUP,
+               CC_NUM_COMMANDS};
 
 // fields names and sizes in bytes
 // DEV_ADDRESS (1), COMMAND (1), DATA_SIZE (2), DATA (N), CHECKSUM (1)
@@ -75,11 +82,24 @@ typedef struct cc_msg_t {
 ****************************************************************************************************
 */
 
+// messages come from a pool and their buffers are not zeroed
+// cc_msg_new() returns a message which fits any frame, cc_msg_new_size() one which fits data_size
 cc_msg_t* cc_msg_new(void);
+cc_msg_t* cc_msg_new_size(int data_size);
 void cc_msg_delete(cc_msg_t *msg);
-void cc_msg_parser(const cc_msg_t *msg, void *data_struct);
+cc_msg_t* cc_msg_dup(const cc_msg_t *msg);
+// decode a received message into its data struct, returns -1 if the message is malformed
+int cc_msg_parser(const cc_msg_t *msg, void *data_struct);
 cc_msg_t* cc_msg_builder(int device_id, int command, const void *data_struct);
+
+// exact data size of the message cc_msg_builder() would build
+int cc_msg_data_size(int command, const void *data_struct);
+
+// serialize the message into the buffer msg->data points to, which must fit cc_msg_data_size()
+// bytes, e.g. a transmit frame slot; sets the other fields and returns the data size
+int cc_msg_encode(cc_msg_t *msg, int device_id, int command, const void *data_struct);
 void cc_msg_print(const char *header, const cc_msg_t *msg);
+void cc_msg_pool_stats(cc_msg_pool_stats_t *stats);
 
 
 /*
@@ -0,0 +1,122 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include <string.h>
+#include "stats.h"
+
+
+/*
+****************************************************************************************************
+*       INTERNAL MACROS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL CONSTANTS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL DATA TYPES
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL GLOBAL VARIABLES
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL FUNCTIONS
+****************************************************************************************************
+*/
+
+static int bucket_index(int64_t value)
+{
+    int index = 0;
+
+    while (value > 0 && index < CC_HISTOGRAM_BUCKETS - 1)
+    {
+        value >>= 1;
+        index++;
+    }
+
+    return index;
+}
+
+
+/*
+****************************************************************************************************
+*       GLOBAL FUNCTIONS
+****************************************************************************************************
+*/
+
+void cc_histogram_reset(cc_histogram_t *histogram)
+{
+    memset(histogram, 0, sizeof(cc_histogram_t));
+}
+
+void cc_histogram_add(cc_histogram_t *histogram, int64_t value)
+{
+    if (histogram->count == 0 || value < histogram->min)
+        histogram->min = value;
+
+    if (histogram->count == 0 || value > histogram->max)
+        histogram->max = value;
+
+    histogram->buckets[bucket_index(value)]++;
+    histogram->sum += value;
+    histogram->count++;
+}
+
+int64_t cc_histogram_percentile(const cc_histogram_t *histogram, int percentile)
+{
+    if (histogram->count == 0)
+        return 0;
+
+    // amount of samples which must be below the returned value
+    uint64_t target = ((uint64_t) histogram->count * percentile + 99) / 100;
+    uint64_t total = 0;
+
+    for (int i = 0; i < CC_HISTOGRAM_BUCKETS; i++)
+    {
+        total += histogram->buckets[i];
+        if (total >= target)
+        {
+            int64_t upper = i == 0 ? 0 : ((int64_t) 1 << i) - 1;
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CC_STATS_H
+#define CC_STATS_H
+
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include <stdint.h>
+
+
+/*
+****************************************************************************************************
+*       MACROS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION
+****************************************************************************************************
+*/
+
+#define CC_HISTOGRAM_BUCKETS    24
+
+
+/*
+****************************************************************************************************
+*       DATA TYPES
+****************************************************************************************************
+*/
+
+// histogram of time values in microseconds
+// bucket 0 counts values below 1 us, bucket N counts values in [2^(N-1), 2^N) us
+// the last bucket also counts everything above its range
+typedef struct cc_histogram_t {
+    uint32_t buckets[CC_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    int64_t min, max, sum;
+} cc_histogram_t;
+
+// chain sync clock statistics
+// period is the time between two consecutive cycles, idle cycles are further apart
+// lateness is how long after its deadline a cycle started
+// idle: no device is on the chain and only handshake cycles are sent, at a stretched cadence
+// active_time, idle_time: time spent in each mode in us
+typedef struct cc_sync_stats_t {
+    uint32_t cycles, overruns;
+    cc_histogram_t period, lateness;
+    int idle;
+    int64_t active_time, idle_time;
+} cc_sync_stats_t;
+
+// transmit statistics
+// queue_depth: requests waiting for a requests cycle
+// backlog: bytes not yet accepted by the serial driver
+// in_flight: backlog plus the bytes still in the driver output buffer
+// requests, request_windows: requests sent and the requests windows that carried them
+// coalesced: value updates dropped because a newer one for the same actuator was queued
+// dropped_frames: frames not sent because the backlog was full (the line is stalled), requests
+// carried by them are completed with an error
+// the other fields are totals since the handle was created
+typedef struct cc_tx_stats_t {
+    uint32_t queue_depth, backlog, in_flight;
+    uint32_t writes, frames, partial_writes, dropped_frames;
+    uint32_t requests, request_windows, coalesced;
+} cc_tx_stats_t;
+
+// serial link statistics
+// low_latency: the driver low latency flag was applied
+// latency_timer: usb-serial latency timer in ms, -1 if not available
+// rtt: time from a device descriptor request until its reply starts to arrive
+// baudrate, framing: current link settings, upgrades/fallbacks: negotiated link changes
+typedef struct cc_link_stats_t {
+    int low_latency, latency_timer;
+    cc_histogram_t rtt;
+    int baudrate, framing;
+    uint32_t upgrades, fallbacks, crc_errors;
+} cc_link_stats_t;
+
+// bus airtime statistics, the airtime is the time the bytes take on the line at the current baud rate
+// tx_bytes, rx_bytes: totals since the handle was created
+// airtime: airtime of the bytes sent and received in each sync cycle, in us
+// load, load_max: share of the last cycle and of the busiest cycle used, in permille
+// sync_interval, response_timeout: current values in us, see auto_timing option
+typedef struct cc_bus_stats_t {
+    uint32_t tx_bytes, rx_bytes;
+    cc_histogram_t airtime;
+    uint32_t load, load_max;
+    int sync_interval, response_timeout;
+} cc_bus_stats_t;
+
+// callback dispatcher statistics
+// depth: events waiting for their callback, max_depth: the deepest the rings have been
+// dispatched: callbacks called, overflows: data updates dropped because their ring was full
+// (device status events are never dropped)
+// latency: time from an event being queued until its callback is called
+typedef struct cc_dispatch_stats_t {
+    uint32_t depth, max_depth, dispatched, overflows;
+    cc_histogram_t latency;
+} cc_dispatch_stats_t;
+
+// message pool statistics
+// hits: messages served from the pool, misses: messages that had to be allocated
+// cached: free messages kept by the pool, in_use: messages handed out and not deleted yet
+typedef struct cc_msg_pool_stats_t {
+    uint32_t hits, misses, cached, in_use;
+} cc_msg_pool_stats_t;
+
+
+/*
+****************************************************************************************************
+*       FUNCTION PROTOTYPES
+****************************************************************************************************
+*/
+
+void cc_histogram_reset(cc_histogram_t *histogram);
+void cc_histogram_add(cc_histogram_t *histogram, int64_t value);
+
+// return the upper bound of the bucket holding the given percentile (0 - 100)
+int64_t cc_histogram_percentile(const cc_histogram_t *histogram, int percentile);
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION ERRORS
+****************************************************************************************************
+*/
+
+
+#endif
@@ -0,0 +1,426 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <libserialport.h>
+#include "transport.h"
+
+
+/*
+****************************************************************************************************
+*       INTERNAL MACROS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL CONSTANTS
+****************************************************************************************************
+*/
+
+static const struct {
+    int baudrate;
+    speed_t speed;
+} g_speeds[] = {
+    {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200},
+    {230400, B230400}, {460800, B460800}, {500000, B500000}, {576000, B576000},
+    {921600, B921600}, {1000000, B1000000}, {1500000, B1500000}, {2000000, B2000000},
+};
+
+
+/*
+****************************************************************************************************
+*       INTERNAL DATA TYPES
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL GLOBAL VARIABLES
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       INTERNAL FUNCTIONS
+****************************************************************************************************
+*/
+
+static int fd_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0)
+        return -1;
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static int fd_read(cc_transport_t *transport, uint8_t *buffer, int size, unsigned int timeout)
+{
+    if (timeout)
+    {
+        struct pollfd pfd = {.fd = transport->fd, .events = POLLIN};
+        int ret = poll(&pfd, 1, timeout);
+        if (ret <= 0)
+            return (ret < 0 && errno != EINTR) ? -1 : 0;
+    }
+
+    int ret = read(transport->fd, buffer, size);
+    if (ret < 0)
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+    // end of file, the other side was closed
+    // ttys in raw mode also return zero when there is nothing to read
+    if (ret == 0 && !isatty(transport->fd))
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    return ret;
+}
+
+static int fd_write(cc_transport_t *transport, const struct iovec *iov, int iovcnt)
+{
+    return writev(transport->fd, iov, iovcnt);
+}
+
+static int fd_get(const cc_transport_t *transport)
+{
+    return transport->fd;
+}
+
+static void fd_close(cc_transport_t *transport)
+{
+    if (transport->fd >= 0)
+        close(transport->fd);
+
+    transport->fd = -1;
+}
+
+//////// serial
+
+static void serial_close(cc_transport_t *transport)
+{
+    if (transport->port)
+    {
+        sp_close(transport->port);
+        sp_free_port(transport->port);
+        transport->port = NULL;
+    }
+
+    transport->fd = -1;
+}
+
+static int serial_open(cc_transport_t *transport, const char *address, int baudrate)
+{
+    struct sp_port *port;
+
+    if (sp_get_port_by_name(address, &port) != SP_OK)
+        return -1;
+
+    if (sp_open(port, SP_MODE_READ_WRITE) != SP_OK)
+    {
+        sp_free_port(port);
+        return -1;
+    }
+
+    transport->port = port;
+
+    // file descriptor is used for vectored writes and by the event loop
+    if (sp_get_port_handle(port, &transport->fd) != SP_OK)
+    {
+        serial_close(transport);
+        return -1;
+    }
+
+    // disable XON/XOFF flow control
+    sp_set_xon_xoff(port, SP_XONXOFF_DISABLED);
+
+    // configure serial port
+    sp_set_baudrate(port, baudrate);
+
+    char *manufacturer = sp_get_port_usb_manufacturer(port);
+    transport->reset_on_open = manufacturer && strstr(manufacturer, "Arduino");
+
+    return 0;
+}
+
+static int serial_read(cc_transport_t *transport, uint8_t *buffer, int size, unsigned int timeout)
+{
+    if (timeout == 0)
+        return sp_nonblocking_read(transport->port, buffer, size);
+
+    return sp_blocking_read_next(transport->port, buffer, size, timeout);
+}
+
+static int serial_set_baudrate(cc_transport_t *transport, int baudrate)
+{
+    return sp_set_baudrate(transport->port, baudrate);
+}
+
+static int serial_drain(cc_transport_t *transport)
+{
+    return sp_drain(transport->port);
+}
+
+//////// file descriptor
+
+static int tty_set_baudrate(cc_transport_t *transport, int baudrate)
+{
+    struct termios tty;
+    if (tcgetattr(transport->fd, &tty))
+        return -1;
+
+    for (unsigned int i = 0; i < sizeof(g_speeds) / sizeof(g_speeds[0]); i++)
+    {
+        if (g_speeds[i].baudrate == baudrate)
+        {
+            cfsetspeed(&tty, g_speeds[i].speed);
+            return tcsetattr(transport->fd, TCSANOW, &tty);
+        }
+    }
+
+    return -1;
+}
+
+static int tty_drain(cc_transport_t *transport)
+{
+    if (!isatty(transport->fd))
+        return 0;
+
+    return tcdrain(transport->fd);
+}
+
+static int tty_open(cc_transport_t *transport, const char *address, int baudrate)
+{
+    char *end;
+    long fd = strtol(address, &end, 10);
+
+    if (*address && *end == 0)
+    {
+        // reopen it, a duplicate would share the file status flags (O_NONBLOCK) with the caller
+        // what can't be reopened (e.g.: sockets) is duplicated, the caller's one then turns non blocking
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/self/fd/%ld", fd);
+
+        transport->fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (transport->fd < 0)
+            transport->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+    else
+        transport->fd = open(address, O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+    if (transport->fd < 0 || fd_nonblock(transport->fd))
+    {
+        fd_close(transport);
+        return -1;
+    }
+
+    // raw mode, reads return whatever is available
+    struct termios tty;
+    if (tcgetattr(transport->fd, &tty) == 0)
+    {
+        cfmakeraw(&tty);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+        tcsetattr(transport->fd, TCSANOW, &tty);
+        tty_set_baudrate(transport, baudrate);
+    }
+
+    return 0;
+}
+
+//////// sockets
+
+static int socket_write(cc_transport_t *transport, const struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg = {.msg_iov = (struct iovec *) iov, .msg_iovlen = iovcnt};
+
+    // don't get a SIGPIPE if the other side was closed
+    int ret = sendmsg(transport->fd, &msg, MSG_NOSIGNAL);
+    if (ret < 0 && (errno == EPIPE || errno == ECONNRESET))
+        errno = EIO;
+
+    return ret;
+}
+
+static int tcp_open(cc_transport_t *transport, const char *address, int baudrate)
+{
+    (void) baudrate;
+
+    // split host and port
+    char host[256];
+    const char *port = strrchr(address, ':');
+    if (!port || port == address || (size_t) (port - address) >= sizeof(host))
+        return -1;
+
+    memcpy(host, address, port - address);
+    host[port - address] = 0;
+    port++;
+
+    // accept [::1]:port
+    char *phost = host;
+    if (host[0] == '[' && host[strlen(host) - 1] == ']')
+    {
+        host[strlen(host) - 1] = 0;
+        phost++;
+    }
+
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM}, *addresses;
+    if (getaddrinfo(phost, port, &hints, &addresses))
+        return -1;
+
+    transport->fd = -1;
+    for (struct addrinfo *ai = addresses; ai; ai = ai->ai_next)
+    {
+        transport->fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (transport->fd < 0)
+            continue;
+
+        if (connect(transport->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+
+        fd_close(transport);
+    }
+
+    freeaddrinfo(addresses);
+
+    if (transport->fd < 0)
+        return -1;
+
+    // frames are small and latency matters more than throughput
+    int one = 1;
+    setsockopt(transport->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    return fd_nonblock(transport->fd);
+}
+
+static int loopback_open(cc_transport_t *transport, const char *address, int baudrate)
+{
+    (void) address;
+    (void) baudrate;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds))
+        return -1;
+
+    transport->fd = fds[0];
+    transport->peer_fd = fds[1];
+
+    return fd_nonblock(transport->fd);
+}
+
+static void loopback_close(cc_transport_t *transport)
+{
+    fd_close(transport);
+
+    if (transport->peer_fd >= 0)
+        close(transport->peer_fd);
+
+    transport->peer_fd = -1;
+}
+
+
+/*
+****************************************************************************************************
+*       GLOBAL FUNCTIONS
+****************************************************************************************************
+*/
+
+const cc_transport_ops_t cc_transport_serial = {
+    .name = "serial",
+    .open = serial_open,
+    .read = serial_read,
+    .write = fd_write,
+    .fd = fd_get,
+    .set_baudrate = serial_set_baudrate,
+    .drain = serial_drain,
+    .close = serial_close,
+};
+
+const cc_transport_ops_t cc_transport_fd = {
+    .name = "fd",
+    .open = tty_open,
+    .read = fd_read,
+    .write = fd_write,
+    .fd = fd_get,
+    .set_baudrate = tty_set_baudrate,
+    .drain = tty_drain,
+    .close = fd_close,
+};
+
+const cc_transport_ops_t cc_transport_tcp = {
+    .name = "tcp",
+    .open = tcp_open,
+    .read = fd_read,
+    .write = socket_write,
+    .fd = fd_get,
+    .close = fd_close,
+};
+
+const cc_transport_ops_t cc_transport_loopback = {
+    .name = "loopback",
+    .open = loopback_open,
+    .read = fd_read,
+    .write = socket_write,
+    .fd = fd_get,
+    .close = loopback_close,
+};
+
+const cc_transport_ops_t* cc_transport_select(const char *address, const char **path)
+{
+    static const cc_transport_ops_t *transports[] = {
+        &cc_transport_fd, &cc_transport_tcp, &cc_transport_loopback
+    };
+
+    for (unsigned int i = 0; i < sizeof(transports) / sizeof(transports[0]); i++)
+    {
+        int len = strlen(transports[i]->name);
+        if (strncmp(address, transports[i]->name, len) == 0 && address[len] == ':')
+        {
+            *path = &address[len + 1];
+            return transports[i];
+        }
+    }
+
+    *path = address;
+    return &cc_transport_serial;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the control chain project
+ *
+ * Copyright (C) 2016 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CC_TRANSPORT_H
+#define CC_TRANSPORT_H
+
+
+/*
+****************************************************************************************************
+*       INCLUDE FILES
+****************************************************************************************************
+*/
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+
+/*
+****************************************************************************************************
+*       MACROS
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION
+****************************************************************************************************
+*/
+
+
+/*
+****************************************************************************************************
+*       DATA TYPES
+****************************************************************************************************
+*/
+
+typedef struct cc_transport_t cc_transport_t;
+
+// transport operations
+// open: open the given address, returns 0 on success
+// read: read up to size bytes waiting at most timeout ms, a zero timeout doesn't wait
+//       returns the amount read, 0 if nothing arrived or -1 on error (errno EIO if the link is gone)
+// write: write the buffers without blocking, returns the amount written or -1 on error
+// fd: file descriptor to wait on for reading and writing
+// set_baudrate, drain: optional, NULL if not applicable to the transport
+// close: close the transport, it can be opened again afterwards
+typedef struct cc_transport_ops_t {
+    const char *name;
+    int (*open)(cc_transport_t *transport, const char *address, int baudrate);
+    int (*read)(cc_transport_t *transport, uint8_t *buffer, int size, unsigned int timeout);
+    int (*write)(cc_transport_t *transport, const struct iovec *iov, int iovcnt);
+    int (*fd)(const cc_transport_t *transport);
+    int (*set_baudrate)(cc_transport_t *transport, int baudrate);
+    int (*drain)(cc_transport_t *transport);
+    void (*close)(cc_transport_t *transport);
+} cc_transport_ops_t;
+
+// reset_on_open: the device resets when the port is opened (e.g.: Arduino)
+// peer_fd: the device side of the loopback transport
+struct cc_transport_t {
+    const cc_transport_ops_t *ops;
+    int fd, peer_fd;
+    int reset_on_open;
+    void *port;
+};
+
+// serial port using libserialport, this is the default transport
+extern const cc_transport_ops_t cc_transport_serial;
+
+// "fd:N" reopens an already opened file descriptor, its file status flags are left untouched
+// sockets can't be reopened, they are duplicated and so the caller's one is made non blocking
+// "fd:/dev/pts/N" opens a tty (e.g.: pty) or any other character device
+extern const cc_transport_ops_t cc_transport_fd;
+
+// "tcp:host:port" connects to a serial to network bridge (e.g.: ser2net)
+extern const cc_transport_ops_t cc_transport_tcp;
+
+// "loopback:" creates an in-process socket pair, the device side is the peer fd
+extern const cc_transport_ops_t cc_transport_loopback;
+
+
+/*
+****************************************************************************************************
+*       FUNCTION PROTOTYPES
+****************************************************************************************************
+*/
+
+// return the transport according the address scheme, path is set to the address without the scheme
+const cc_transport_ops_t* cc_transport_select(const char *address, const char **path);
+
+
+/*
+****************************************************************************************************
+*       CONFIGURATION ERRORS
+****************************************************************************************************
+*/
+
+
+#endif
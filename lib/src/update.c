@@ -72,10 +72,18 @@
 
 #define UPDATE_DATA_SIZE (sizeof(float) + 1)
 
-cc_update_list_t *cc_update_parse(int device_id, uint8_t *raw_data, bool check_assignments)
+cc_update_list_t *cc_update_parse(int device_id, const uint8_t *raw_data, int raw_size,
+    bool check_assignments)
 {
+    if (raw_size < 1)
+        return NULL;
+
     const uint8_t count = *raw_data++;
 
+    // all the updates must be within the message
+    if (raw_size < (int) (UPDATE_DATA_SIZE * count + 1))
+        return NULL;
+
     // create and initialize update list
     cc_update_list_t *updates = malloc(sizeof(cc_update_list_t));
     updates->device_id = device_id;
@@ -98,9 +106,8 @@ cc_update_list_t *cc_update_parse(int device_id, uint8_t *raw_data, bool check_a
             // update id
             data->assignment_id = assignment.id;
 
-            // update value
-            float *value = (float *) (raw_data + 1);
-            data->value = *value;
+            // update value, it's not aligned
+            memcpy(&data->value, raw_data + 1, sizeof(float));
 
             // copy raw data
             memcpy(updates->raw_data + k, raw_data, UPDATE_DATA_SIZE);
@@ -77,7 +77,9 @@ typedef struct cc_update_list_t {
 ****************************************************************************************************
 */
 
-cc_update_list_t *cc_update_parse(int device_id, uint8_t *raw_data, bool check_assignments);
+// returns NULL if the updates don't fit raw_size
+cc_update_list_t *cc_update_parse(int device_id, const uint8_t *raw_data, int raw_size,
+    bool check_assignments);
 void cc_update_free(cc_update_list_t *updates);
 
 
@@ -100,9 +100,13 @@ union floby_t {
 */
 
 uint8_t crc8(const uint8_t *data, uint32_t len)
+{
+    return crc8_update(0x00, data, len);
+}
+
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, uint32_t len)
 {
     const uint8_t *end;
-    uint8_t crc = 0x00;
 
     if (len == 0)
         return crc;
@@ -183,6 +187,19 @@ void string_destroy(string_t *str)
     }
 }
 
+void *arena_alloc(arena_t *arena, uint32_t size)
+{
+    size = ARENA_ALIGN(size);
+
+    if (arena->used + size > arena->size)
+        return NULL;
+
+    void *ptr = &arena->buffer[arena->used];
+    arena->used += size;
+
+    return ptr;
+}
+
 int float_to_bytes(const float value, uint8_t *array)
 {
     union floby_t aux;
@@ -191,3 +208,37 @@ int float_to_bytes(const float value, uint8_t *array)
 
     return (sizeof(float));
 }
+
+uint32_t cobs_encode(const struct iovec *iov, int iovcnt, uint8_t *buffer)
+{
+    uint8_t *code = buffer, *out = buffer + 1;
+    uint8_t count = 1;
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        const uint8_t *data = iov[i].iov_base;
+        const uint8_t *end = data + iov[i].iov_len;
+
+        for (; data < end; data++)
+        {
+            if (*data)
+            {
+                *out++ = *data;
+                count++;
+            }
+
+            // a zero or a full block closes the current block
+            if (*data == 0 || count == 0xFF)
+            {
+                *code = count;
+                code = out++;
+                count = 1;
+            }
+        }
+    }
+
+    *code = count;
+    *out++ = 0;
+
+    return out - buffer;
+}
@@ -27,6 +27,7 @@
 */
 
 #include <stdint.h>
+#include <sys/uio.h>
 
 
 /*
@@ -38,6 +39,15 @@
 #define STR_AUX(s)  #s
 #define STR(s)      STR_AUX(s)
 
+// worst case size of cobs encoded data, including the zero delimiter
+#define COBS_ENCODED_SIZE(len)  ((len) + (len)/254 + 2)
+
+// arena allocations are pointer aligned
+#define ARENA_ALIGN(size)       (((size) + sizeof (void *) - 1) & ~(sizeof (void *) - 1))
+
+// arena room taken by a string of the given length
+#define STRING_ARENA_SIZE(len)  (ARENA_ALIGN(sizeof (string_t)) + ARENA_ALIGN((len) + 1))
+
 
 /*
 ****************************************************************************************************
@@ -61,6 +71,12 @@ typedef struct version_t {
     int major, minor, micro;
 } version_t;
 
+// bump allocator, all allocations are released at once by freeing the buffer
+typedef struct arena_t {
+    uint8_t *buffer;
+    uint32_t size, used;
+} arena_t;
+
 
 /*
 ****************************************************************************************************
@@ -76,13 +92,24 @@ typedef struct version_t {
 */
 uint8_t crc8(const uint8_t *data, uint32_t len);
 
+// continue a crc8 calculation, crc8_update(crc8(a), b) == crc8(a + b)
+// a new calculation can be started by passing crc = 0
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, uint32_t len);
+
 string_t *string_create(const char *str);
 uint8_t string_serialize(const string_t *str, uint8_t *buffer);
 string_t *string_deserialize(const uint8_t *data, uint32_t *written);
 void string_destroy(string_t *str);
 
+// returns NULL if the arena has no room left
+void *arena_alloc(arena_t *arena, uint32_t size);
+
 int float_to_bytes(const float value, uint8_t *array);
 
+// cobs encode the concatenation of the given buffers and append the zero delimiter
+// returns the encoded size, the buffer must have room for COBS_ENCODED_SIZE bytes
+uint32_t cobs_encode(const struct iovec *iov, int iovcnt, uint8_t *buffer);
+
 /*
 ****************************************************************************************************
 *       CONFIGURATION ERRORS
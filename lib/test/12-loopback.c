@@ -0,0 +1,70 @@
+// clock_gettime()
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "control_chain.h"
+
+// in-process chain, no hardware required
+#define SERIAL_PORT         "loopback:"
+#define SERIAL_BAUDRATE     115200
+
+static int count_frames(const uint8_t *buffer, int size, int device_id, int command)
+{
+    // sync byte (0xA7), device id and command
+    int count = 0;
+    for (int i = 0; i + 2 < size; i++)
+    {
+        if (buffer[i] == 0xA7 && buffer[i+1] == device_id && buffer[i+2] == command)
+            count++;
+    }
+
+    return count;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(void)
+{
+    cc_handle_t *handle = cc_init(SERIAL_PORT, SERIAL_BAUDRATE);
+    if (!handle)
+    {
+        printf("can't initiate control chain using %s\n", SERIAL_PORT);
+        exit(1);
+    }
+
+    // the device side of the chain
+    int fd = cc_transport_peer(handle);
+
+    printf("waiting one second\n");
+    sleep(1);
+
+    // no device is on the chain, the handshake syncs go further and further apart
+    // (instead of one sync every 10 ms)
+    uint8_t buffer[4096];
+    int ret = read(fd, buffer, sizeof(buffer));
+    int syncs = count_frames(buffer, ret, 0, CC_CMD_CHAIN_SYNC);
+
+    printf("sync messages received: %i\n", syncs);
+
+    // requests are still served while idle, without waiting for the next idle cycle
+    double start = now_ms();
+    cc_device_disable(handle, 1);
+    double elapsed = now_ms() - start;
+
+    ret = read(fd, buffer, sizeof(buffer));
+    int requests = count_frames(buffer, ret, 1, CC_CMD_DEV_CONTROL);
+
+    printf("device disable sent: %i, took %.1f ms\n", requests, elapsed);
+
+    cc_finish(handle);
+
+    return (syncs >= 1 && syncs <= 10 && requests == 1 && elapsed < 100) ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// poll(), clock_gettime()
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include "control_chain.h"
+
+// in-process chain, the test plays two devices on the device side
+// both join on the same handshake cycle and their descriptors are requested in the same window
+// the first one never replies, the second one replies right away: only the first must time out
+// the line is kept busy meanwhile, the bytes of other devices must not keep a silent one alive
+#define SERIAL_PORT         "loopback:"
+#define SERIAL_BAUDRATE     115200
+
+#define SYNC_HANDSHAKE_CYCLE    2
+#define SILENT_RANDOM_ID        0x1111
+#define REPLYING_RANDOM_ID      0x2222
+
+static int g_fd;
+static int g_silent_id, g_replying_id, g_acks;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void send_frame(int device_id, int command, const uint8_t *data, int size)
+{
+    uint8_t frame[256];
+
+    frame[0] = 0xA7;
+    frame[1] = device_id;
+    frame[2] = command;
+    frame[3] = size & 0xFF;
+    frame[4] = size >> 8;
+    memcpy(&frame[5], data, size);
+    frame[5 + size] = crc8(&frame[1], 4 + size);
+
+    if (write(g_fd, frame, 6 + size) < 0)
+        printf("write failed\n");
+}
+
+static void send_handshake(uint16_t random_id)
+{
+    // random id, protocol v0.7, firmware v1.0.0
+    uint8_t data[] = {random_id & 0xFF, random_id >> 8, 0, 7, 1, 0, 0};
+    send_frame(0, CC_CMD_HANDSHAKE, data, sizeof(data));
+}
+
+static void send_descriptor(int device_id)
+{
+    // uri, label, one actuator, no actuator groups, no pagination, chain id
+    uint8_t data[] = {
+        8, 't', 'e', 's', 't', ':', 'd', 'e', 'v',
+        4, 'T', 'e', 's', 't',
+        1, 4, 'K', 'n', 'o', 'b', 0xFF, 0x0F, 0, 0, 1,
+        0,
+        0, 1, 0
+    };
+    send_frame(device_id, CC_CMD_DEV_DESCRIPTOR, data, sizeof(data));
+}
+
+static void frame_received(int device_id, int command, const uint8_t *data, int size)
+{
+    if (command == CC_CMD_CHAIN_SYNC && size == 1 && data[0] == SYNC_HANDSHAKE_CYCLE && !g_silent_id)
+    {
+        send_handshake(SILENT_RANDOM_ID);
+        send_handshake(REPLYING_RANDOM_ID);
+    }
+    else if (command == CC_CMD_HANDSHAKE && size == 4)
+    {
+        // random id, status, device id
+        int random_id = data[0] | data[1] << 8;
+        if (random_id == SILENT_RANDOM_ID)
+            g_silent_id = data[3];
+        else if (random_id == REPLYING_RANDOM_ID)
+            g_replying_id = data[3];
+    }
+    else if (command == CC_CMD_DEV_DESCRIPTOR && device_id == g_replying_id && size == 1)
+    {
+        if (data[0] == CC_DEVICE_DESC_ACK)
+            g_acks++;
+        else
+            send_descriptor(device_id);
+    }
+}
+
+// parse the frames sent by the master: sync byte, header, data and crc
+static void read_frames(int timeout)
+{
+    static uint8_t frame[4 + 256 + 1];
+    static int count = -1, size;
+
+    struct pollfd pfd = {.fd = g_fd, .events = POLLIN};
+    if (poll(&pfd, 1, timeout) <= 0)
+        return;
+
+    uint8_t buffer[1024];
+    int ret = read(g_fd, buffer, sizeof(buffer));
+
+    for (int i = 0; i < ret; i++)
+    {
+        if (count < 0)
+        {
+            if (buffer[i] == 0xA7)
+                count = 0;
+            continue;
+        }
+
+        frame[count++] = buffer[i];
+
+        if (count == 4)
+        {
+            size = frame[2] | frame[3] << 8;
+            if (size > 256)
+                count = -1;
+        }
+        else if (count > 4 && count == 4 + size + 1)
+        {
+            if (crc8(frame, 4 + size) == frame[4 + size])
+                frame_received(frame[0], frame[1], &frame[4], size);
+
+            count = -1;
+        }
+    }
+}
+
+int main(void)
+{
+    cc_handle_t *handle = cc_init(SERIAL_PORT, SERIAL_BAUDRATE);
+    if (!handle)
+    {
+        printf("can't initiate control chain using %s\n", SERIAL_PORT);
+        exit(1);
+    }
+
+    g_fd = cc_transport_peer(handle);
+
+    // run until the silent device is dropped
+    double deadline = now_ms() + 2000;
+    while (now_ms() < deadline)
+    {
+        read_frames(10);
+
+        // keep the line busy once the devices joined (the master skips what isn't a frame)
+        if (g_silent_id)
+        {
+            uint8_t idle = 0;
+            if (write(g_fd, &idle, 1) < 0)
+                printf("write failed\n");
+        }
+
+        if (g_acks && g_silent_id && !cc_device_get(g_silent_id))
+            break;
+    }
+
+    cc_device_t *silent = g_silent_id ? cc_device_get(g_silent_id) : NULL;
+    cc_device_t *replying = g_replying_id ? cc_device_get(g_replying_id) : NULL;
+
+    printf("silent device (id: %i): %s\n", g_silent_id, silent ? "kept" : "dropped");
+    printf("replying device (id: %i): %s, descriptor acks: %i\n", g_replying_id,
+        replying ? "kept" : "dropped", g_acks);
+
+    int ok = g_silent_id && g_replying_id && !silent && replying && g_acks == 1;
+
+    cc_finish(handle);
+
+    return ok ? 0 : 1;
+}
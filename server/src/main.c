@@ -73,6 +73,12 @@ typedef struct clients_events_t {
     int event_id;
 } clients_events_t;
 
+typedef struct reply_completion_t {
+    cc_completion_t completion;
+    int client_fd;
+    const char *request, *format;
+} reply_completion_t;
+
 
 /*
 ****************************************************************************************************
@@ -84,6 +90,7 @@ static sockser_t *g_server;
 static clients_events_t g_client_events[MAX_CLIENTS_EVENTS];
 static char *g_serial;
 static int g_baudrate, g_foreground;
+static cc_options_t g_options;
 
 
 /*
@@ -157,6 +164,42 @@ static void send_reply(int client_fd,  const char *reply, json_t *data)
     free(output.buffer);
 }
 
+static void reply_cb(cc_completion_t *completion)
+{
+    reply_completion_t *reply = completion->arg;
+
+    // the error is only known once the request is done
+    json_t *data;
+    if (completion->ret < 0)
+        data = json_pack(CC_REQUEST_ERROR_FORMAT, "error", completion->ret);
+    else
+        data = json_pack(reply->format);
+
+    send_reply(reply->client_fd, reply->request, data);
+    free(reply);
+}
+
+// the reply is sent from the completion callback, by the thread which completed the request
+// request and format must be static strings
+static cc_completion_t* reply_completion(int client_fd, const char *request, const char *format)
+{
+    reply_completion_t *reply = calloc(1, sizeof(reply_completion_t));
+    if (!reply)
+    {
+        json_t *data = json_pack(CC_REQUEST_ERROR_FORMAT, "error", -1);
+        send_reply(client_fd, request, data);
+        return NULL;
+    }
+
+    reply->client_fd = client_fd;
+    reply->request = request;
+    reply->format = format;
+    reply->completion.callback = reply_cb;
+    reply->completion.arg = reply;
+
+    return &reply->completion;
+}
+
 static void send_event(int client_fd, const char *event, const char *data)
 {
     sockser_data_t output;
@@ -234,9 +277,15 @@ static void client_event_cb(void *arg)
 
 static void print_usage(int status)
 {
-    printf("Usage: " SERVER_NAME " <serial> [-bVh]\n");
+    printf("Usage: " SERVER_NAME " <serial> [-acdefl] [-b <baudrate>] [-u <baudrate>] [-Vh]\n");
+    printf("  -a    size the sync interval and the timeouts from the bus load\n");
     printf("  -b    define baud rate\n");
+    printf("  -c    use cobs framing when all devices support it\n");
+    printf("  -d    run the callbacks on a dispatcher thread\n");
+    printf("  -e    use the event loop engine\n");
     printf("  -f    run server on foreground\n");
+    printf("  -l    configure the serial port for low latency\n");
+    printf("  -u    baud rate to upgrade to when all devices support it\n");
     printf("  -V,   display version information and exit\n");
     printf("  -h,   display this help and exit\n");
 
@@ -262,14 +311,38 @@ static void parse_cmd_line(int argc, char **argv)
     g_baudrate = SERIAL_BAUDRATE;
 
     int opt;
-    while ((opt = getopt(argc, argv, "bfVh")) != -1)
+    while ((opt = getopt(argc, argv, "abcdeflu:Vh")) != -1)
     {
         switch (opt)
         {
+            case 'a':
+                g_options.auto_timing = 1;
+                break;
+
             case 'b':
                 g_baudrate = atoi(argv[optind]);
                 break;
 
+            case 'c':
+                g_options.link_framing = CC_FRAMING_COBS;
+                break;
+
+            case 'd':
+                g_options.dispatcher = 1;
+                break;
+
+            case 'e':
+                g_options.engine = CC_ENGINE_EVENT_LOOP;
+                break;
+
+            case 'l':
+                g_options.low_latency = 1;
+                break;
+
+            case 'u':
+                g_options.link_baudrate = atoi(optarg);
+                break;
+
             case 'f':
                 g_foreground = 1;
                 break;
@@ -354,7 +427,7 @@ int main(int argc, char **argv)
     sockser_client_event_cb(g_server, client_event_cb);
 
     // init control chain
-    cc_handle_t *handle = cc_init(g_serial, g_baudrate);
+    cc_handle_t *handle = cc_init_options(g_serial, g_baudrate, &g_options);
     if (!handle)
     {
         syslog(LOG_ERR, "error starting control chain using serial '%s'", g_serial);
@@ -427,11 +500,11 @@ int main(int argc, char **argv)
             json_unpack(data, CC_DEV_CONTROL_REQ_FORMAT, "device_id", &device_id,
                 "enable", &enable);
 
-            cc_device_disable(handle, device_id);
+            cc_completion_t *completion = reply_completion(client_fd, "device_control",
+                CC_DEV_CONTROL_REPLY_FORMAT);
 
-            // pack data and send reply
-            json_t *data = json_pack(CC_DEV_CONTROL_REPLY_FORMAT);
-            send_reply(client_fd, request, data);
+            if (completion)
+                cc_device_disable_async(handle, device_id, completion);
         }
         else if (strcmp(request, "device_status") == 0)
         {
@@ -505,21 +578,30 @@ int main(int argc, char **argv)
             }
 
             int assignment_id, assignment_pair_id, actuator_pair_id;
+            int main_actuator_id = -1;
+
+            // the actuators are part of the device descriptor, which the library may replace meanwhile
+            cc_device_lock();
 
             // get the page of the actuator to assign
             const int actuators_in_page = device->actuators_count + device->actuatorgroups_count;
-            const int actuator_page_id = assignment.actuator_id / actuators_in_page; // intentionally round down
+            const int actuator_page_id = actuators_in_page ? assignment.actuator_id / actuators_in_page : 0; // intentionally round down
             const int actuator_page_offset = actuator_page_id * actuators_in_page;
             const int actuator_group_id = assignment.actuator_id - device->actuators_count - actuator_page_offset;
 
-            // special handling if assigning to group
             if (actuator_group_id >= 0 && actuator_group_id < device->actuatorgroups_count)
             {
                 cc_actuatorgroup_t *actuatorgroup = device->actuatorgroups[actuator_group_id];
 
-                int main_actuator_id = actuatorgroup->actuators_in_actuatorgroup[0] + actuator_page_offset;
+                main_actuator_id = actuatorgroup->actuators_in_actuatorgroup[0] + actuator_page_offset;
                 actuator_pair_id = actuatorgroup->actuators_in_actuatorgroup[1] + actuator_page_offset;
+            }
+
+            cc_device_unlock();
 
+            // special handling if assigning to group
+            if (main_actuator_id >= 0)
+            {
                 // real assignment
                 assignment.actuator_id = main_actuator_id;
                 assignment.actuator_pair_id = actuator_pair_id;
@@ -570,11 +652,11 @@ int main(int argc, char **argv)
                 "assignment_pair_id", &assignment.pair_id,
                 "device_id", &assignment.device_id);
 
-            cc_unassignment(handle, &assignment);
+            cc_completion_t *completion = reply_completion(client_fd, "unassignment",
+                CC_UNASSIGNMENT_REPLY_FORMAT);
 
-            // pack data and send reply
-            json_t *data = json_pack(CC_UNASSIGNMENT_REPLY_FORMAT);
-            send_reply(client_fd, request, data);
+            if (completion)
+                cc_unassignment_async(handle, &assignment, completion);
         }
         else if (strcmp(request, "value_set") == 0)
         {
@@ -590,12 +672,11 @@ int main(int argc, char **argv)
             // double to float
             update.value = value;
 
-            cc_value_set(handle, &update);
-
-            // pack data and send reply
-            json_t *data = json_pack(CC_VALUE_SET_REPLY_FORMAT);
-            send_reply(client_fd, request, data);
+            cc_completion_t *completion = reply_completion(client_fd, "value_set",
+                CC_VALUE_SET_REPLY_FORMAT);
 
+            if (completion)
+                cc_value_set_async(handle, &update, completion);
         }
         else if (strcmp(request, "data_update") == 0)
         {
@@ -60,6 +60,10 @@
 #define CC_DATA_UPDATE_REPLY_FORMAT     "n"
 #define CC_DATA_UPDATE_EVENT_FORMAT     "{si,ss}"
 
+#define CC_REQUEST_ERROR_FORMAT         "{si}"
+
+#define CC_REQUEST_ERROR_FORMAT         "{si}"
+
 
 /*
 ****************************************************************************************************